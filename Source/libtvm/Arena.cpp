@@ -0,0 +1,113 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Arena.h"
+#include <cstring>
+#include <new>
+
+Arena::Arena(size_t blockSize) :
+    m_blocks(),
+    m_blockSize(blockSize),
+    m_used(0),
+    m_total(0)
+{
+}
+
+Arena::~Arena()
+{
+    clear();
+}
+
+Arena::Arena(Arena&& rhs) noexcept :
+    m_blocks(),
+    m_blockSize(rhs.m_blockSize),
+    m_used(0),
+    m_total(0)
+{
+    merge(rhs);
+}
+
+Arena& Arena::operator=(Arena&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        clear();
+        m_blockSize = rhs.m_blockSize;
+        merge(rhs);
+    }
+    return *this;
+}
+
+void* Arena::grow(size_t size, size_t align)
+{
+    // malloc returns blocks that meet any fundamental alignment,
+    // so a new allocation always starts at offset zero. Allocations
+    // larger than a block get a block of their own.
+    (void)align;
+
+    size_t len = size > m_blockSize ? size : m_blockSize;
+
+    uint8_t* data = (uint8_t*)malloc(len);
+    if (!data)
+        throw std::bad_alloc();
+
+    m_blocks.push_back({data, len});
+    m_used = size;
+    m_total += size;
+    return data;
+}
+
+std::string_view Arena::store(const std::string_view& str)
+{
+    char* dest = (char*)allocate(str.size() + 1, 1);
+    if (!str.empty())
+        memcpy(dest, str.data(), str.size());
+    dest[str.size()] = 0;
+    return std::string_view(dest, str.size());
+}
+
+void Arena::merge(Arena& rhs)
+{
+    if (this == &rhs || rhs.m_blocks.empty())
+        return;
+
+    // allocation carries on in the last block of rhs
+    m_blocks.insert(m_blocks.end(), rhs.m_blocks.begin(), rhs.m_blocks.end());
+    m_used = rhs.m_used;
+    m_total += rhs.m_total;
+
+    rhs.m_blocks.clear();
+    rhs.m_used  = 0;
+    rhs.m_total = 0;
+}
+
+void Arena::clear(void)
+{
+    Blocks::iterator it = m_blocks.begin();
+    while (it != m_blocks.end())
+    {
+        free(it->data);
+        ++it;
+    }
+    m_blocks.clear();
+    m_used  = 0;
+    m_total = 0;
+}
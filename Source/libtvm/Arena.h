@@ -0,0 +1,96 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Arena_h_
+#define _Arena_h_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string_view>
+#include <vector>
+
+// A bump allocator that hands out memory from large blocks. Nothing
+// is freed on its own; everything is released at once by clear or
+// when the arena is destroyed. Blocks never move, so pointers into
+// the arena stay valid until then.
+class Arena
+{
+private:
+    struct Block
+    {
+        uint8_t* data;
+        size_t   size;
+    };
+    using Blocks = std::vector<Block>;
+
+    Blocks m_blocks;
+    size_t m_blockSize;
+    size_t m_used;   // bytes used in the last block
+    size_t m_total;  // bytes handed out
+
+    void* grow(size_t size, size_t align);
+
+public:
+    Arena(size_t blockSize = 0x10000);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // The blocks move with the arena, so pointers
+    // into them stay valid.
+    Arena(Arena&& rhs) noexcept;
+    Arena& operator=(Arena&& rhs) noexcept;
+
+    // Returns size bytes aligned to align, which must be a power of
+    // two no larger than alignof(std::max_align_t).
+    void* allocate(size_t size, size_t align = sizeof(void*))
+    {
+        if (!m_blocks.empty())
+        {
+            const Block& last = m_blocks.back();
+
+            size_t offs = (m_used + align - 1) & ~(align - 1);
+            if (offs + size <= last.size)
+            {
+                m_used = offs + size;
+                m_total += size;
+                return last.data + offs;
+            }
+        }
+        return grow(size, align);
+    }
+
+    // Copies str into the arena with a null terminator.
+    std::string_view store(const std::string_view& str);
+
+    // Takes over the blocks of rhs, leaving it empty.
+    void merge(Arena& rhs);
+
+    void clear(void);
+
+    size_t bytes(void) const
+    {
+        return m_total;
+    }
+};
+
+#endif  //_Arena_h_
@@ -25,6 +25,7 @@
 #include <memory.h>
 #include <stdint.h>
 #include <string.h>
+#include "PageMemory.h"
 
 class ArrayStack
 {
@@ -35,7 +36,9 @@ public:
     ArrayStack() :
         m_size(0),
         m_capacity(0),
-        m_data(0)
+        m_data(0),
+        m_mode(PM_DEFAULT),
+        m_mapped(false)
     {
     }
 
@@ -48,7 +51,7 @@ public:
     {
         if (m_data)
         {
-            delete[] m_data;
+            release(m_data, m_capacity, m_mapped);
 
             m_size     = 0;
             m_data     = nullptr;
@@ -56,20 +59,38 @@ public:
         }
     }
 
+    // Sets how the storage is allocated the next time it grows.
+    void setMode(int mode)
+    {
+        m_mode = mode;
+    }
+
     void reserve(uint32_t nr)
     {
         if (nr > m_capacity)
         {
-            Data* dt = new Data[((size_t)nr) + 1];
+            size_t len    = ((size_t)nr + 1) * sizeof(Data);
+            bool   mapped = false;
+            Data*  dt     = nullptr;
+
+            if (m_mode == PM_HUGE)
+            {
+                dt     = (Data*)MapPages(len, PM_HUGE);
+                mapped = dt != nullptr;
+            }
+            if (!dt)
+                dt = new Data[((size_t)nr) + 1];
 
             if (m_size > 0 && m_data != nullptr)
-                memcpy(dt, m_data, m_size);
- 
+                memcpy(dt, m_data, m_size * sizeof(Data));
+
             dt[nr] = -1;
-            delete[] m_data;
+            if (m_data)
+                release(m_data, m_capacity, m_mapped);
 
             m_data     = dt;
             m_capacity = nr;
+            m_mapped   = mapped;
         }
     }
 
@@ -137,6 +158,16 @@ private:
     uint32_t m_size;
     uint32_t m_capacity;
     Data*    m_data;
+    int      m_mode;
+    bool     m_mapped;
+
+    static void release(Data* data, uint32_t capacity, bool mapped)
+    {
+        if (mapped)
+            UnmapPages(data, ((size_t)capacity + 1) * sizeof(Data), PM_HUGE);
+        else
+            delete[] data;
+    }
 };
 
 #endif  //_ArrayStack_h_
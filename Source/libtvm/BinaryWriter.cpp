@@ -25,8 +25,47 @@
 
 #include "BinaryWriter.h"
 #include <stdio.h>
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include "SymbolUtils.h"
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+inline size_t getDataWidth(uint16_t type)
+{
+    switch (type)
+    {
+    case SEC_BYTE:
+        return 1;
+    case SEC_WORD:
+        return 2;
+    case SEC_LONG:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+// String literals are always read-only. Anything else
+// has to be declared in a .rodata section.
+inline bool isReadOnly(const DataDeclaration& dt)
+{
+    return dt.readonly || dt.type == SEC_ASCII;
+}
+
+// Returns the number of bytes a section takes up in the
+// file, not counting its header or padding.
+inline size_t getStoredSize(size_t size, const LZBuffer& lz)
+{
+    return lz.empty() ? size : sizeof(uint64_t) + lz.size();
+}
 
 inline uint16_t getAlignment(size_t al)
 {
@@ -38,84 +77,178 @@ inline uint16_t getAlignment(size_t al)
 
 BinaryWriter::BinaryWriter(const str_t& modpath) :
     m_fp(0),
+    m_map(nullptr),
     m_loc(0),
-    m_ins(),
+    m_sizeOfImage(0),
+    m_sync(false),
+    m_unit(),
     m_sizeOfCode(0),
     m_sizeOfData(0),
+    m_sizeOfBss(0),
+    m_sizeOfRodata(0),
+    m_rodataAddr(0),
     m_sizeOfSym(0),
     m_sizeOfStr(0),
-    m_addrMap(),
-    m_labels(),
+    m_sizeOfFunc(0),
+    m_labelAddr(),
     m_header({}),
+    m_flags(0),
+    m_capture(nullptr),
     m_modpath(modpath)
 {
+    m_unit.labels = 0;
 }
 
 BinaryWriter::~BinaryWriter()
 {
+    unmapOutput();
     if (m_fp)
         fclose((FILE*)m_fp);
 }
 
-void BinaryWriter::mergeInstructions(const Instructions& insl)
+int BinaryWriter::mergeUnit(CompileUnit& unit)
 {
-    m_ins.reserve(m_ins.size() + insl.size());
-    Instructions::const_iterator it = insl.begin(), end = insl.end();
-    while (it != end)
-        m_ins.push_back(*it++);
-}
+    if (m_unit.names.empty())
+    {
+        m_unit = std::move(unit);
+        return PS_OK;
+    }
 
-int BinaryWriter::mergeDataDeclarations(const DataLookup& data)
-{
     // There should be no conflict between labels defined
     // elsewhere in the file. The scanner will weed out duplicates
     // before execution reaches this step.
     int status = PS_OK;
 
-    DataLookup::const_iterator it = data.begin(), end = data.end();
-    while (it != end && status == PS_OK)
+    using NameMap = std::vector<uint32_t>;
+
+    NameMap names(unit.names.size());
+
+    size_t i;
+    for (i = 0; i < names.size(); ++i)
+        names[i] = m_unit.names.intern(unit.names.get(i));
+    m_unit.info.resize(m_unit.names.size());
+
+    for (i = 0; i < unit.info.size() && status == PS_OK; ++i)
     {
-        const str_t& name = it->first;
-        if (m_dataDecl.find(name) != m_dataDecl.end())
+        NameInfo& info = m_unit.info[names[i]];
+        if (unit.info[i].label == 0)
+            continue;
+
+        if (info.label != 0)
         {
-            printf("duplicate label '%s'\n", name.c_str());
+            printf("duplicate label '%s'\n", unit.names.c_str(i));
             status = PS_ERROR;
         }
         else
-            m_dataDecl[name] = it->second;
-
-        ++it;
+            info.label = unit.info[i].label + m_unit.labels;
     }
-    return status;
-}
 
-int BinaryWriter::mergeLabels(const LabelMap& map)
-{
-    int status = PS_OK;
-
-    LabelMap::const_iterator it = map.begin();
-    while (it != map.end() && status == PS_OK)
+    DataDeclarations::iterator dt = unit.data.begin();
+    while (dt != unit.data.end() && status == PS_OK)
     {
-        if (m_labels.find(it->first) != m_labels.end())
+        NameInfo& info = m_unit.info[names[dt->name]];
+        if (info.data != 0)
         {
-            printf("duplicate label '%s'\n", it->first.c_str());
+            printf("duplicate label '%s'\n", unit.names.c_str(dt->name));
             status = PS_ERROR;
         }
         else
         {
-            m_labels[it->first]   = it->second;
-            m_addrMap[it->second] = 0;
+            dt->name = names[dt->name];
+            m_unit.data.push_back(std::move(*dt));
+            info.data = (uint32_t)m_unit.data.size();
         }
+        ++dt;
+    }
 
-        ++it;
+    if (status == PS_OK)
+    {
+        Instructions::iterator it = unit.ins.begin();
+        for (; it != unit.ins.end(); ++it)
+        {
+            it->name = names[it->name];
+            it->label += m_unit.labels;
+        }
+
+        m_unit.ins.insert(m_unit.ins.end(), unit.ins.begin(), unit.ins.end());
+        m_unit.labels += unit.labels;
+
+        // the string values are still in the unit's arena
+        m_unit.strings.merge(unit.strings);
     }
+
+    unit = CompileUnit();
     return status;
 }
 
+void BinaryWriter::setFormatFlags(uint16_t flags)
+{
+    // Compressed code is always fixed width, so that it
+    // expands straight into the program's instructions.
+    if (flags & HF_LZ)
+        flags |= HF_FIXED;
+    m_flags = flags;
+}
+
+void BinaryWriter::setSync(bool sync)
+{
+    m_sync = sync;
+}
+
 void BinaryWriter::write(const void* v, size_t size)
 {
-    if (m_fp)
-        fwrite(v, 1, size, (FILE*)m_fp);
+    if (m_capture)
+    {
+        const uint8_t* bytes = (const uint8_t*)v;
+        m_capture->insert(m_capture->end(), bytes, bytes + size);
+    }
+    else if (m_map)
+    {
+        // Anything past the end is counted but not copied,
+        // so writeSections reports the size mismatch.
+        if (size <= m_sizeOfImage - std::min(m_loc, m_sizeOfImage))
+            memcpy(m_map + m_loc, v, size);
+        m_loc += size;
+    }
+    else
+        m_image.writeBlock(v, size);
+}
+
+size_t BinaryWriter::getWrittenSize(void) const
+{
+    return m_map ? m_loc : m_image.size();
+}
+
+int BinaryWriter::mapOutput(void)
+{
+    unmapOutput();
+#ifdef _WIN32
+    return PS_UNDEFINED;
+#else
+    // Anything that cannot be mapped, such as a pipe,
+    // is built in memory and written out by close.
+    int fd = fileno((FILE*)m_fp);
+    if (m_sizeOfImage == 0 || ftruncate(fd, (off_t)m_sizeOfImage) != 0)
+        return PS_UNDEFINED;
+
+    void* map = mmap(nullptr, m_sizeOfImage, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return PS_UNDEFINED;
+
+    m_map = (uint8_t*)map;
+    m_loc = 0;
+    return PS_OK;
+#endif
+}
+
+void BinaryWriter::unmapOutput(void)
+{
+#ifndef _WIN32
+    if (m_map)
+        munmap(m_map, m_sizeOfImage);
+#endif
+    m_map = nullptr;
+    m_loc = 0;
 }
 
 void BinaryWriter::write8(uint8_t v)
@@ -138,12 +271,26 @@ void BinaryWriter::write64(uint64_t v)
     write(&v, sizeof(uint64_t));
 }
 
+void BinaryWriter::writePadding(size_t nr)
+{
+    static const uint8_t zeros[16] = {};
+    while (nr > 0)
+    {
+        size_t len = nr < sizeof zeros ? nr : sizeof zeros;
+        write(zeros, len);
+        nr -= len;
+    }
+}
+
 int BinaryWriter::open(const char* fname)
 {
+    unmapOutput();
     if (m_fp)
         fclose((FILE*)m_fp);
 
-    m_fp = fopen(fname, "wb");
+    // It is opened for reading as well, since
+    // a shared mapping needs both.
+    m_fp = fopen(fname, "w+b");
     if (!m_fp)
     {
         printf("failed to open '%s' for writing.\n", fname);
@@ -152,57 +299,165 @@ int BinaryWriter::open(const char* fname)
     return PS_OK;
 }
 
-uint64_t BinaryWriter::addToStringTable(const str_t& symname)
+int BinaryWriter::close(void)
 {
-    LabelMap::iterator it = m_strtab.find(symname);
-    if (it != m_strtab.end())
-        return it->second;
+    int status = PS_OK;
+    if (m_fp)
+    {
+        FILE* fp = (FILE*)m_fp;
+
+        if (m_map)
+        {
+#ifndef _WIN32
+            if (m_sync && msync(m_map, m_sizeOfImage, MS_SYNC) != 0)
+                status = PS_ERROR;
+#endif
+            unmapOutput();
+        }
+        else
+        {
+            // The image is handed to the system in one call.
+            size_t len = m_image.size();
+            if (len > 0 && fwrite(m_image.ptr(), 1, len, fp) != len)
+                status = PS_ERROR;
+        }
 
-    m_sizeOfStr += symname.size();
-    m_sizeOfStr += 1;
+        // fclose also reports anything that failed to
+        // reach the file, such as a full disk.
+        if (m_sync && (fflush(fp) != 0 || fsync(fileno(fp)) != 0))
+            status = PS_ERROR;
+        if (fclose(fp) != 0)
+            status = PS_ERROR;
 
-    size_t size       = m_strtab.size();
-    m_strtab[symname] = size;
+        if (status != PS_OK)
+            printf("failed to write the output file.\n");
+        m_fp = nullptr;
+    }
+    return status;
+}
 
-    m_orderedString.push_back(symname);
-    return size;
+uint64_t BinaryWriter::addToStringTable(const str_t& symname)
+{
+    uint32_t idx = m_strtab.intern(symname);
+    m_sizeOfStr  = m_strtab.byteSize();
+    return idx;
 }
 
-uint64_t BinaryWriter::addToDataTable(const DataDeclaration& dt)
+uint64_t BinaryWriter::addToDataTable(uint32_t idx)
 {
-    uint64_t startAddr = m_sizeOfData;
+    if (m_dataAddr.size() != m_unit.data.size())
+        m_dataAddr.assign(m_unit.data.size(), NO_INDEX);
+
+    if (m_dataAddr[idx] != NO_INDEX)
+        return m_dataAddr[idx];
+
+    const DataDeclaration& dt = m_unit.data[idx];
+    if (dt.type == SEC_ZERO)
+        return addToBssTable(idx);
+    if (isReadOnly(dt))
+        return addToTable(m_rodataLayout, m_sizeOfRodata, idx);
+    return addToTable(m_dataLayout, m_sizeOfData, idx);
+}
 
-    LabelMap::iterator it = m_datatab.find(dt.lname);
-    if (it != m_datatab.end())
-        return it->second;
-    else
-        m_datatab[dt.lname] = startAddr;
+uint64_t BinaryWriter::addToTable(DataLayout& layout, size_t& size, uint32_t idx)
+{
+    const DataDeclaration& dt = m_unit.data[idx];
 
-    if (dt.type == SEC_ASCII)
+    // Only the address is assigned here. The values are
+    // written straight to the file by writeDeclarations.
+    if (dt.type != SEC_ASCII)
     {
-        m_sizeOfData += m_dataTable.writeString(dt.sval.c_str(),
-                                                dt.sval.size());
-    }
-    else if (dt.type == SEC_ZERO)
-    {
-        m_sizeOfData += m_dataTable.fill((size_t)dt.ival, 0);
+        size_t width = getDataWidth(dt.type);
+        size += (width - size % width) % width;
     }
+
+    uint64_t startAddr = size;
+    m_dataAddr[idx]    = startAddr;
+    layout.push_back(&dt);
+
+    if (dt.type == SEC_ASCII)
+        size += dt.sval.size() + 1;
     else
+        size += dt.values.size() * getDataWidth(dt.type);
+    return startAddr;
+}
+
+void BinaryWriter::writeDeclarations(const DataLayout& layout)
+{
+    // Integers are stored at their declared width,
+    // and aligned to it.
+    size_t size = 0;
+
+    DataLayout::const_iterator it = layout.begin();
+    for (; it != layout.end(); ++it)
     {
-        m_sizeOfData += m_dataTable.write64(dt.ival);
+        const DataDeclaration& dt = *(*it);
+        if (dt.type == SEC_ASCII)
+        {
+            write(dt.sval.data(), dt.sval.size());
+            write8(0);
+            size += dt.sval.size() + 1;
+            continue;
+        }
+
+        size_t width = getDataWidth(dt.type);
+        size_t pad   = (width - size % width) % width;
+        size += pad;
+        writePadding(pad);
+
+        // quads are stored as they are held
+        if (width == 8)
+            write(dt.values.data(), dt.values.size() * width);
+        else
+        {
+            DataValues::const_iterator val = dt.values.begin();
+            for (; val != dt.values.end(); ++val)
+            {
+                if (width == 1)
+                    write8((uint8_t)*val);
+                else if (width == 2)
+                    write16((uint16_t)*val);
+                else
+                    write32((uint32_t)*val);
+            }
+        }
+        size += dt.values.size() * width;
     }
+}
+
+uint64_t BinaryWriter::addToBssTable(uint32_t idx)
+{
+    // Only the size is recorded. The address is relative
+    // to the start of the BSS section until it is fixed.
+    const DataDeclaration& dt = m_unit.data[idx];
+
+    uint64_t startAddr = m_sizeOfBss;
+    m_dataAddr[idx]    = startAddr;
+
+    m_sizeOfBss += (size_t)dt.ival;
+    m_sizeOfBss += (8 - m_sizeOfBss % 8) % 8;
     return startAddr;
 }
 
 uint64_t BinaryWriter::addLinkedSymbol(const str_t& symname, const str_t& libname)
 {
-    if (m_linkedLibraries.find(libname) == m_linkedLibraries.end())
-    {
-        m_linkedLibraries.insert(libname);
-        m_sizeOfSym += libname.size();
-        m_sizeOfSym += 1;
-    }
-    return addToStringTable(symname);
+    TVMImport imp = {};
+    imp.library   = m_libraries.intern(libname);
+    imp.name      = (uint32_t)addToStringTable(symname);
+
+    // one import slot per unique symbol
+    IndexToPosition::iterator it = m_importSlots.find(imp.name);
+    if (it != m_importSlots.end())
+        return it->second;
+
+    uint64_t slot           = m_imports.size();
+    m_importSlots[imp.name] = slot;
+    m_imports.push_back(imp);
+
+    m_sizeOfSym = sizeof(uint32_t) * 2;
+    m_sizeOfSym += m_imports.size() * sizeof(TVMImport);
+    m_sizeOfSym += m_libraries.dataSize();
+    return slot;
 }
 
 int BinaryWriter::mapInstructions(void)
@@ -212,90 +467,183 @@ int BinaryWriter::mapInstructions(void)
     uint64_t lookup = 0;
     int      status = PS_OK;
 
-    using InstPtr = std::vector<Instruction*>;
+    FunctionStarts starts;
 
-    InstPtr symbols;
+    m_labelAddr.assign(m_unit.labels + 1, NO_INDEX);
 
-    Instructions::iterator it = m_ins.begin();
-    while (it != m_ins.end())
+    Instructions::iterator it = m_unit.ins.begin();
+    while (it != m_unit.ins.end())
     {
-        Instruction& ins = (*it++);
+        const Instruction& ins = (*it++);
 
         // look for changes in the label index then
         // save the index of the first change.
         if (ins.label != label)
         {
-            label            = ins.label;
-            m_addrMap[label] = insp;
+            label              = ins.label;
+            m_labelAddr[label] = insp;
         }
-
-        // store it so it can be resolved
-        // after all labels have been indexed
-        if (!ins.lname.empty())
-            symbols.push_back(&ins);
-
         ++insp;
     }
 
-    InstPtr::iterator symit = symbols.begin();
-    while (symit != symbols.end())
+    // A label with no instructions of its own starts at the next
+    // one that has some. One that no instruction follows starts
+    // past the end of the code, where nothing can branch to it.
+    uint64_t next = m_unit.ins.size();
+    size_t   idx  = m_labelAddr.size();
+    while (idx-- > 0)
     {
-        Instruction* irp = (*symit++);
+        if (m_labelAddr[idx] == NO_INDEX)
+            m_labelAddr[idx] = next;
+        else
+            next = m_labelAddr[idx];
+    }
+
+    // Now that all labels have been indexed, resolve the names.
+    for (it = m_unit.ins.begin(); it != m_unit.ins.end(); ++it)
+    {
+        Instruction& ins = (*it);
+        if (ins.name == 0)
+            continue;
 
         // modify the first argument so that it points
         // to the correct instruction index.
-        lookup = findLabel(irp->lname);
-        if (lookup != -1)
+        lookup = findLabel(ins.name);
+        if (lookup == m_unit.ins.size())
+        {
+            printf("no instructions follow the label '%s'\n", m_unit.names.c_str(ins.name));
+            status = PS_ERROR;
+        }
+        else if (lookup != NO_INDEX)
         {
             // It points to a local label
-            irp->argv[0] = lookup;
-            irp->flags |= IF_ADDR;
+            ins.argv[0] = lookup;
+            ins.flags |= IF_ADDR;
+
+            // and every call target starts a function
+            if (ins.op == OP_GTO)
+                addFunction(starts, lookup, ins.name);
+        }
+        else if (m_unit.info[ins.name].data != 0)
+        {
+            // It points to a data entry
+            uint32_t idx = m_unit.info[ins.name].data - 1;
+
+            uint64_t* arg = &ins.argv[1];
+            if (ins.flags & IF_REG2)
+                arg = &ins.argv[2];
+
+            *arg = addToDataTable(idx);
+            ins.flags |= IF_ADRD;
+
+            const DataDeclaration& dt = m_unit.data[idx];
+            if (dt.type == SEC_ZERO)
+                m_bssFixups.push_back(arg);
+            else if (isReadOnly(dt))
+                m_rodataFixups.push_back(arg);
         }
         else
         {
-            DataLookup::iterator it;
-            it = m_dataDecl.find(irp->lname);
-            if (it != m_dataDecl.end())
+            // It points to an unknown symbol
+            // that may reside in a shared library.
+            lookup = findSymbol(ins.name);
+            if (lookup != NO_INDEX)
             {
-                // It points to a data entry
-                if (irp->flags & IF_REG2)
-                    irp->argv[2] = addToDataTable(it->second);
-                else
-                    irp->argv[1] = addToDataTable(it->second);
-                irp->flags |= IF_ADRD;
+                ins.argv[0] = lookup;
+                ins.flags |= IF_SYMU;
             }
             else
             {
-                // It points to an unknown symbol
-                // that may reside in a shared library.
-                StringLookup::iterator it = m_symbols.find(irp->lname);
-                if (it != m_symbols.end())
-                {
-                    irp->argv[0] = addLinkedSymbol(irp->lname, it->second);
-                    irp->flags |= IF_SYMU;
-                }
-                else
-                {
-                    printf("failed to locate '%s'\n", irp->lname.c_str());
-                    status = PS_ERROR;
-                }
+                printf("failed to locate '%s'\n", m_unit.names.c_str(ins.name));
+                status = PS_ERROR;
             }
         }
     }
+
+    int64_t main = m_unit.names.find("main");
+    if (main > 0)
+    {
+        lookup = findLabel((uint32_t)main);
+        if (lookup < m_unit.ins.size())
+            addFunction(starts, lookup, (uint32_t)main);
+    }
+
+    if (status == PS_OK)
+        mapFunctions(starts);
     return status;
 }
 
+void BinaryWriter::addFunction(FunctionStarts& starts, uint64_t insp, uint32_t name)
+{
+    // When more than one name starts at the same place, keep the
+    // first one by name, so that the output does not depend on
+    // the order that the names were found in.
+    FunctionStarts::iterator fn = starts.find(insp);
+    if (fn == starts.end() || m_unit.names.get(name) < m_unit.names.get(fn->second))
+        starts[insp] = name;
+}
+
+void BinaryWriter::mapFunctions(FunctionStarts& starts)
+{
+    // Code in front of the first function still
+    // needs an owner, so give it the first label.
+    if (starts.find(0) == starts.end())
+    {
+        uint32_t name = 0, i;
+        for (i = 1; i < (uint32_t)m_unit.info.size(); ++i)
+        {
+            if (findLabel(i) == 0 && (name == 0 || m_unit.names.get(i) < m_unit.names.get(name)))
+                name = i;
+        }
+        starts[0] = name;
+    }
+
+    m_functions.clear();
+    m_functionNames.clear();
+
+    FunctionStarts::iterator fn = starts.begin();
+    while (fn != starts.end())
+    {
+        TVMFunction func = {};
+        func.start       = (uint32_t)fn->first;
+        func.name        = (uint32_t)m_functionNames.size();
+
+        m_functionNames += m_unit.names.get(fn->second);
+        m_functionNames.push_back('\0');
+
+        ++fn;
+
+        uint64_t end = fn != starts.end() ? fn->first : m_unit.ins.size();
+        func.count   = (uint32_t)(end - func.start);
+        m_functions.push_back(func);
+    }
+}
+
 size_t BinaryWriter::calculateInstructionSize(void)
 {
     size_t i;
     size_t size = 0;
 
-    Instructions::iterator it = m_ins.begin(), endp = m_ins.end();
+    TVMFunctions::iterator fn = m_functions.begin();
+    if (m_flags & HF_FIXED)
+    {
+        for (; fn != m_functions.end(); ++fn)
+            fn->offset = (uint32_t)(fn->start * sizeof(ExecInstruction));
+        return m_unit.ins.size() * sizeof(ExecInstruction);
+    }
+
+    uint64_t insp = 0;
+
+    Instructions::iterator it = m_unit.ins.begin(), endp = m_unit.ins.end();
     while (it != endp)
     {
         Instruction& ins = (*it++);
         ins.sizes        = 0;
 
+        if (fn != m_functions.end() && fn->start == insp)
+            (fn++)->offset = (uint32_t)size;
+        ++insp;
+
         size += 6;  // op, nr, flags, sizes
         if (ins.flags & IF_RIDX)
             size += 1;
@@ -326,19 +674,68 @@ size_t BinaryWriter::calculateInstructionSize(void)
     return size;
 }
 
-uint64_t BinaryWriter::findLabel(const str_t& name)
+size_t BinaryWriter::calculateFunctionSize(void)
+{
+    if (m_functions.empty())
+        return 0;
+
+    size_t size = sizeof(uint64_t);
+    size += m_functions.size() * sizeof(TVMFunction);
+    size += m_functionNames.size();
+    return size;
+}
+
+uint64_t BinaryWriter::findLabel(uint32_t name)
 {
-    if (!name.empty())
+    if (name != 0 && name < m_unit.info.size())
     {
-        LabelMap::iterator it = m_labels.find(name);
-        if (it != m_labels.end())
-        {
-            IndexToPosition::iterator fidx = m_addrMap.find(it->second);
-            if (fidx != m_addrMap.end())
-                return fidx->second;
-        }
+        uint64_t label = m_unit.info[name].label;
+        if (label != 0 && label < m_labelAddr.size())
+            return m_labelAddr[label];
     }
-    return -1;
+    return NO_INDEX;
+}
+
+uint64_t BinaryWriter::findLabel(const char* name)
+{
+    int64_t idx = m_unit.names.find(name);
+    if (idx > 0)
+        return findLabel((uint32_t)idx);
+    return NO_INDEX;
+}
+
+uint64_t BinaryWriter::findSymbol(uint32_t name)
+{
+    // the library lookup is done once per name
+    IndexToPosition::iterator slot = m_symbolSlots.find(name);
+    if (slot != m_symbolSlots.end())
+        return slot->second;
+
+    const str_t symname(m_unit.names.get(name));
+
+    StringLookup::iterator it = m_symbols.find(symname);
+    if (it == m_symbols.end())
+        return NO_INDEX;
+
+    uint64_t idx        = addLinkedSymbol(symname, it->second);
+    m_symbolSlots[name] = idx;
+    return idx;
+}
+
+bool BinaryWriter::isValidSymbol(const SymbolTable& sym)
+{
+    if (sym.callback == nullptr || (sym.attributes & ~SA_MASK) != 0)
+        return false;
+    if (sym.attributes & SA_RMSK && (sym.reads & ~SYM_REGS) != 0)
+        return false;
+    if (sym.attributes & SA_WMSK && (sym.writes & ~SYM_REGS) != 0)
+        return false;
+
+    // A pure call can be skipped when its inputs repeat, which
+    // is only sound if every input and output is a known register.
+    if (sym.attributes & SA_PURE && (sym.attributes & SA_PREQ) != SA_PREQ)
+        return false;
+    return true;
 }
 
 int BinaryWriter::loadSharedLibrary(const str_t& lib)
@@ -365,7 +762,14 @@ int BinaryWriter::loadSharedLibrary(const str_t& lib)
             {
                 const str_t            str = avail[i].name;
                 StringLookup::iterator it  = m_symbols.find(str);
-                if (it == m_symbols.end())
+                if (!isValidSymbol(avail[i]))
+                {
+                    printf("invalid attributes for symbol %s in library %s\n",
+                           str.c_str(),
+                           lib.c_str());
+                    status = PS_ERROR;
+                }
+                else if (it == m_symbols.end())
                     m_symbols[str] = lib;
                 else
                 {
@@ -409,12 +813,10 @@ int BinaryWriter::resolve(strvec_t& modules)
 
 int BinaryWriter::writeHeader()
 {
-    if (!m_fp)
-        return PS_ERROR;
-
     m_header.code[0] = 'T';
     m_header.code[1] = 'V';
-    m_header.flags   = 0;
+    m_header.flags   = m_flags;
+    m_header.version = TVM_VERSION;
 
     size_t offset = sizeof(TVMHeader);
     if (mapInstructions() != PS_OK)
@@ -423,6 +825,20 @@ int BinaryWriter::writeHeader()
         return PS_ERROR;
     }
 
+    // BSS addresses start after the aligned data, and
+    // read-only addresses start after the aligned BSS. They
+    // are fixed before the instruction sizes are measured.
+    uint64_t bss = m_sizeOfData + getAlignment(m_sizeOfData);
+    m_rodataAddr = bss + m_sizeOfBss + getAlignment(bss + m_sizeOfBss);
+
+    AddressFixups::iterator fix = m_bssFixups.begin();
+    while (fix != m_bssFixups.end())
+        *(*fix++) += bss;
+
+    fix = m_rodataFixups.begin();
+    while (fix != m_rodataFixups.end())
+        *(*fix++) += m_rodataAddr;
+
     m_sizeOfCode = calculateInstructionSize();
     if (m_sizeOfCode == 0)
     {
@@ -430,28 +846,79 @@ int BinaryWriter::writeHeader()
         return PS_ERROR;
     }
 
+    // The function index still addresses code with 32 bits.
+    if (m_sizeOfCode > UINT32_MAX || m_unit.ins.size() > UINT32_MAX)
+    {
+        printf("the code section exceeds 4 GB\n");
+        return PS_ERROR;
+    }
+
+    if (m_flags & HF_LZ)
+        compressSections();
+
+    m_sizeOfFunc = calculateFunctionSize();
+    if (m_sizeOfFunc != 0)
+    {
+        m_header.flags |= HF_FUNC;
+        offset += sizeof(TVMSection);
+        offset += m_sizeOfFunc;
+        offset += getAlignment(m_sizeOfFunc);
+    }
+
+    size_t code = getStoredSize(m_sizeOfCode, m_codeLz);
     offset += sizeof(TVMSection);
-    offset += m_sizeOfCode;
-    offset += getAlignment(m_sizeOfCode);
+    offset += code;
+    offset += getAlignment(code);
 
-    if (m_sizeOfData != 0)
+    if (m_sizeOfData != 0 || m_sizeOfBss != 0 || m_sizeOfRodata != 0)
     {
-        m_header.dat = (uint32_t)offset;
+        size_t data = getStoredSize(m_sizeOfData, m_dataLz);
+
+        m_header.dat = offset;
         offset += sizeof(TVMSection);
-        offset += m_sizeOfData;
-        offset += getAlignment(m_sizeOfData);
+        offset += data;
+        offset += getAlignment(data);
+
+        if (m_sizeOfBss != 0)
+        {
+            m_header.flags |= HF_BSS;
+            offset += sizeof(TVMSection);
+        }
+
+        if (m_sizeOfRodata != 0)
+        {
+            m_header.flags |= HF_RODATA;
+            offset += sizeof(TVMSection);
+            offset += m_sizeOfRodata;
+            offset += getAlignment(m_sizeOfRodata);
+        }
     }
 
     if (m_sizeOfSym != 0)
     {
-        m_header.sym = (uint32_t)offset;
+        m_header.sym = offset;
+        m_header.flags |= HF_IMPORT;
         offset += sizeof(TVMSection);
         offset += m_sizeOfSym;
         offset += getAlignment(m_sizeOfSym);
     }
 
     if (m_sizeOfStr != 0)
-        m_header.str = (uint32_t)offset;
+    {
+        m_header.str = offset;
+        m_header.flags |= HF_STRIDX;
+        offset += sizeof(TVMSection);
+        offset += m_sizeOfStr;
+        offset += getAlignment(m_sizeOfStr);
+    }
+
+    // Everything after this is appended to the image, so it
+    // is allocated once at its final size. An open file is
+    // written in place, without a copy of the image in memory.
+    m_sizeOfImage = offset;
+    m_image.clear();
+    if (!m_fp || mapOutput() != PS_OK)
+        m_image.reserve(m_sizeOfImage);
 
     write(&m_header, sizeof(TVMHeader));
     return PS_OK;
@@ -460,120 +927,238 @@ int BinaryWriter::writeHeader()
 size_t BinaryWriter::writeDataSection(void)
 {
     TVMSection sec = {};
-    sec.size       = (uint32_t)m_sizeOfData;
+    sec.size       = m_sizeOfData;
     sec.entry      = m_header.dat;
-    sec.align      = getAlignment(m_sizeOfData);
+    sec.align      = getAlignment(getStoredSize(m_sizeOfData, m_dataLz));
+
+    if (!m_dataLz.empty())
+        sec.flags |= SF_LZ;
 
     write(&sec, sizeof(TVMSection));
-    write(m_dataTable.ptr(), m_dataTable.size());
 
-    int pb = sec.align;
-    while (pb--)
-        write8(0);
+    if (!m_dataLz.empty())
+    {
+        write64(m_dataLz.size());
+        write(m_dataLz.data(), m_dataLz.size());
+    }
+    else
+        writeDeclarations(m_dataLayout);
+
+    writePadding(sec.align);
+
+    if (m_sizeOfBss != 0)
+    {
+        TVMSection bss = {};
+        bss.size       = m_sizeOfBss;
+        write(&bss, sizeof(TVMSection));
+    }
+
+    if (m_sizeOfRodata != 0)
+    {
+        // The file offset of the data is a multiple of 16, so
+        // it can be used in place from a mapped image.
+        TVMSection rod = {};
+        rod.size       = m_sizeOfRodata;
+        rod.start      = m_rodataAddr;
+        rod.align      = getAlignment(m_sizeOfRodata);
+        write(&rod, sizeof(TVMSection));
+        writeDeclarations(m_rodataLayout);
+
+        writePadding(rod.align);
+    }
     return m_sizeOfData;
 }
 
 size_t BinaryWriter::writeCodeSection(void)
 {
     TVMSection sec = {};
-    sec.size       = (uint32_t)m_sizeOfCode;
-    sec.start      = (uint32_t)sizeof(TVMHeader);
-    sec.align      = getAlignment(m_sizeOfCode);
+    sec.size       = m_sizeOfCode;
+    sec.start      = sizeof(TVMHeader);
+
+    if (m_sizeOfFunc != 0)
+    {
+        sec.start += sizeof(TVMSection);
+        sec.start += m_sizeOfFunc + getAlignment(m_sizeOfFunc);
+    }
+    sec.align      = getAlignment(getStoredSize(m_sizeOfCode, m_codeLz));
 
     uint64_t entry = findLabel("main");
-    if (entry == -1)
+    if (entry == NO_INDEX)
     {
         printf("failed to find main entry point\n");
         return PS_ERROR;
     }
-    sec.entry = (uint32_t)entry;
+    if (entry >= m_unit.ins.size())
+    {
+        printf("no instructions follow the main entry point\n");
+        return PS_ERROR;
+    }
+    sec.entry = entry;
+
+    if (!m_codeLz.empty())
+        sec.flags |= SF_LZ;
 
     write(&sec, sizeof(TVMSection));
-    int i;
 
-    Instructions::iterator it = m_ins.begin(), end = m_ins.end();
+    if (!m_codeLz.empty())
+    {
+        write64(m_codeLz.size());
+        write(m_codeLz.data(), m_codeLz.size());
+    }
+    else
+        writeInstructions();
+
+    writePadding(sec.align);
+    return m_sizeOfCode;
+}
+
+void BinaryWriter::writeInstructions(void)
+{
+    Instructions::iterator it = m_unit.ins.begin(), end = m_unit.ins.end();
     while (it != end)
     {
-        const Instruction& ins = (*it++);
+        if (m_flags & HF_FIXED)
+            writeFixedInstruction(*it++);
+        else
+            writeInstruction(*it++);
+    }
+}
 
-        write8(ins.op);
-        write8(ins.argc);
-        write16(ins.flags);
-        write16(ins.sizes);
+void BinaryWriter::compressSections(void)
+{
+    // Each section is built in memory, and only
+    // kept compressed if that makes it smaller.
+    LZBuffer raw;
 
-        if (ins.flags & IF_RIDX)
-            write8(ins.index);
+    m_capture = &raw;
+    writeInstructions();
+    compressSection(raw, m_codeLz);
 
-        for (i = 0; i < ins.argc; ++i)
-        {
-            if (ins.sizes & SizeFlags[i][0])
-                write8((uint8_t)ins.argv[i]);
-            else if (ins.sizes & SizeFlags[i][1])
-                write16((uint16_t)ins.argv[i]);
-            else if (ins.sizes & SizeFlags[i][2])
-                write32((uint32_t)ins.argv[i]);
-            else
-                write64(ins.argv[i]);
-        }
+    raw.clear();
+    writeDeclarations(m_dataLayout);
+    compressSection(raw, m_dataLz);
+    m_capture = nullptr;
+
+    if (m_codeLz.empty() && m_dataLz.empty())
+        m_header.flags &= ~HF_LZ;
+}
+
+void BinaryWriter::compressSection(const LZBuffer& raw, LZBuffer& dest)
+{
+    dest.clear();
+    if (raw.empty())
+        return;
+
+    LZCodec::compress(raw.data(), raw.size(), dest);
+    if (sizeof(uint64_t) + dest.size() >= raw.size())
+        dest.clear();
+}
+
+void BinaryWriter::writeInstruction(const Instruction& ins)
+{
+    int i;
+
+    write8(ins.op);
+    write8(ins.argc);
+    write16(ins.flags);
+    write16(ins.sizes);
+
+    if (ins.flags & IF_RIDX)
+        write8(ins.index);
+
+    for (i = 0; i < ins.argc; ++i)
+    {
+        if (ins.sizes & SizeFlags[i][0])
+            write8((uint8_t)ins.argv[i]);
+        else if (ins.sizes & SizeFlags[i][1])
+            write16((uint16_t)ins.argv[i]);
+        else if (ins.sizes & SizeFlags[i][2])
+            write32((uint32_t)ins.argv[i]);
+        else
+            write64(ins.argv[i]);
     }
+}
 
-    int pb = sec.align;
-    while (pb--)
-        write8(0);
-    return m_sizeOfCode;
+void BinaryWriter::writeFixedInstruction(const Instruction& ins)
+{
+    ExecInstruction exec = {};
+
+    exec.op    = ins.op;
+    exec.argc  = ins.argc;
+    exec.flags = ins.flags;
+    exec.index = ins.index;
+
+    int i;
+    for (i = 0; i < ins.argc && i < INS_ARG; ++i)
+        exec.argv[i] = ins.argv[i];
+
+    write(&exec, sizeof(ExecInstruction));
 }
 
 size_t BinaryWriter::writeSymbolSection(void)
 {
     TVMSection sec = {};
-    sec.size       = (uint32_t)m_sizeOfSym;
+    sec.size       = m_sizeOfSym;
     sec.entry      = m_header.sym;
     sec.align      = getAlignment(m_sizeOfSym);
 
     write(&sec, sizeof(TVMSection));
 
-    strset_t::iterator it = m_linkedLibraries.begin();
-    while (it != m_linkedLibraries.end())
-    {
-        const str_t& str = (*it++);
-        write(str.c_str(), str.size());
-        write8(0);
-    }
+    write32((uint32_t)m_libraries.size());
+    write32((uint32_t)m_imports.size());
+    write(m_imports.data(), m_imports.size() * sizeof(TVMImport));
+    write(m_libraries.data(), m_libraries.dataSize());
 
-    int pb = sec.align;
-    while (pb--)
-        write8(0);
+    writePadding(sec.align);
     return m_sizeOfSym;
 }
 
+size_t BinaryWriter::writeFunctionSection(void)
+{
+    TVMSection sec = {};
+    sec.size       = m_sizeOfFunc;
+    sec.start      = sizeof(TVMHeader);
+    sec.align      = getAlignment(m_sizeOfFunc);
+    write(&sec, sizeof(TVMSection));
+
+    write64(m_functions.size());
+    write(m_functions.data(), m_functions.size() * sizeof(TVMFunction));
+    write(m_functionNames.c_str(), m_functionNames.size());
+
+    writePadding(sec.align);
+    return m_sizeOfFunc;
+}
+
 size_t BinaryWriter::writeStringSection(void)
 {
     TVMSection sec = {};
-    sec.size       = (uint32_t)m_sizeOfStr;
+    sec.size       = m_sizeOfStr;
     sec.entry      = m_header.str;
     sec.align      = getAlignment(m_sizeOfStr);
     write(&sec, sizeof(TVMSection));
 
-    strvec_t::iterator it = m_orderedString.begin();
-    while (it != m_orderedString.end())
-    {
-        const str_t& str = (*it++);
-        write(str.c_str(), str.size());
-        write8(0);
-    }
+    uint32_t count = (uint32_t)m_strtab.size();
+    write32(count);
+    write(m_strtab.offsets(), count * sizeof(uint32_t));
+    write(m_strtab.data(), m_strtab.dataSize());
 
-    int pb = sec.align;
-    while (pb--)
-        write8(0);
+    writePadding(sec.align);
     return m_sizeOfStr;
 }
 
 int BinaryWriter::writeSections()
 {
-    if (!m_fp)
+    if (getWrittenSize() != sizeof(TVMHeader))
         return PS_ERROR;
 
     size_t size;
+    if (m_sizeOfFunc != 0)
+    {
+        size = writeFunctionSection();
+        if (size != m_sizeOfFunc)
+            return PS_ERROR;
+    }
+
     if (m_sizeOfCode != 0)
     {
         size = writeCodeSection();
@@ -581,7 +1166,7 @@ int BinaryWriter::writeSections()
             return PS_ERROR;
     }
 
-    if (m_sizeOfData != 0)
+    if (m_sizeOfData != 0 || m_sizeOfBss != 0 || m_sizeOfRodata != 0)
     {
         size = writeDataSection();
         if (size != m_sizeOfData)
@@ -601,5 +1186,11 @@ int BinaryWriter::writeSections()
         if (size != m_sizeOfStr)
             return PS_ERROR;
     }
+
+    if (getWrittenSize() != m_sizeOfImage)
+    {
+        printf("the image size does not match its header\n");
+        return PS_ERROR;
+    }
     return PS_OK;
 }
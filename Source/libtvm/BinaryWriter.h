@@ -22,49 +22,104 @@
 #ifndef _BinaryWriter_h_
 #define _BinaryWriter_h_
 
+#include <map>
+#include "CompileUnit.h"
 #include "Declarations.h"
+#include "LZCodec.h"
 #include "MemoryStream.h"
+#include "StringTable.h"
 
 class BinaryWriter
 {
 private:
+    // References to BSS and read-only addresses, that need to
+    // be moved past the data section once its size is known.
+    using AddressFixups = std::vector<uint64_t*>;
+
+    // Declarations in address order. They are written to the
+    // file from here, so the data is never copied into a buffer.
+    using DataLayout = std::vector<const DataDeclaration*>;
+
+    // The address of each declaration in its section,
+    // or -1 if it has not been referenced.
+    using DataAddresses = std::vector<uint64_t>;
+
+    // The name of each function by its first instruction.
+    using FunctionStarts = std::map<uint64_t, uint32_t>;
+
     void*           m_fp;
-    long            m_loc;
-    Instructions    m_ins;
+    uint8_t*        m_map;  // the output file, mapped at its final size
+    size_t          m_loc;  // the amount written to m_map
+    MemoryStream    m_image;
+    size_t          m_sizeOfImage;
+    bool            m_sync;
+    CompileUnit     m_unit;
     size_t          m_sizeOfCode;
     size_t          m_sizeOfData;
+    size_t          m_sizeOfBss;
+    size_t          m_sizeOfRodata;
+    uint64_t        m_rodataAddr;
     size_t          m_sizeOfSym;
     size_t          m_sizeOfStr;
-    IndexToPosition m_addrMap;
-    LabelMap        m_labels;
-    LabelMap        m_strtab;
-    LabelMap        m_datatab;
-    strvec_t        m_orderedString;
-    strset_t        m_linkedLibraries;
+    size_t          m_sizeOfFunc;
+    LabelAddresses  m_labelAddr;
+    StringTable     m_strtab;
+    DataAddresses   m_dataAddr;
+    AddressFixups   m_bssFixups;
+    AddressFixups   m_rodataFixups;
+    StringTable     m_libraries;
+    TVMImports      m_imports;
+    IndexToPosition m_importSlots;
     StringLookup    m_symbols;
+    IndexToPosition m_symbolSlots;  // import slot by name
     TVMHeader       m_header;
+    uint16_t        m_flags;
+    LZBuffer        m_codeLz;
+    LZBuffer        m_dataLz;
+    LZBuffer*       m_capture;
     str_t           m_modpath;
-    DataLookup      m_dataDecl;
-    MemoryStream    m_dataTable;
+    DataLayout      m_dataLayout;
+    DataLayout      m_rodataLayout;
+    TVMFunctions    m_functions;
+    str_t           m_functionNames;
 
     void write(const void* v, size_t size);
     void write8(uint8_t v);
     void write16(uint16_t v);
     void write32(uint32_t v);
     void write64(uint64_t v);
+    void writePadding(size_t nr);
+    int  mapOutput(void);
+    void unmapOutput(void);
+    size_t getWrittenSize(void) const;
 
     size_t writeDataSection(void);
     size_t writeCodeSection(void);
     size_t writeSymbolSection(void);
     size_t writeStringSection(void);
+    size_t writeFunctionSection(void);
 
-    int mapInstructions(void);
+    int  mapInstructions(void);
+    void mapFunctions(FunctionStarts& starts);
+    void addFunction(FunctionStarts& starts, uint64_t insp, uint32_t name);
+
+    void compressSections(void);
+    void compressSection(const LZBuffer& raw, LZBuffer& dest);
 
     size_t calculateInstructionSize(void);
+    size_t calculateFunctionSize(void);
+    void   writeInstructions(void);
+    void   writeInstruction(const Instruction& ins);
+    void   writeFixedInstruction(const Instruction& ins);
 
-    uint64_t findLabel(const str_t& name);
+    uint64_t findLabel(uint32_t name);
+    uint64_t findLabel(const char* name);
+    uint64_t findSymbol(uint32_t name);
     uint64_t addToStringTable(const str_t& symname);
-    uint64_t addToDataTable(const DataDeclaration& dt);
+    uint64_t addToDataTable(uint32_t idx);
+    uint64_t addToTable(DataLayout& layout, size_t& size, uint32_t idx);
+    void     writeDeclarations(const DataLayout& layout);
+    uint64_t addToBssTable(uint32_t idx);
     uint64_t addLinkedSymbol(const str_t& symname, const str_t& libname);
     int      loadSharedLibrary(const str_t& lib);
 
@@ -72,12 +127,51 @@ public:
     BinaryWriter(const str_t& modpath);
     ~BinaryWriter();
 
-    void mergeInstructions(const Instructions& insl);
-    int  mergeDataDeclarations(const DataLookup& data);
+    // Moves a parsed file into the writer, leaving unit empty.
+    // The first one is taken as it is. The names of any that
+    // follow are interned into the first one's table, and their
+    // labels are numbered after the ones already merged.
+    int mergeUnit(CompileUnit& unit);
+
+    // The merged program, so that it can be optimized as a whole.
+    CompileUnit& getUnit(void)
+    {
+        return m_unit;
+    }
+
+    // Sets the TVMHeaderFlags of the output file.
+    void setFormatFlags(uint16_t flags);
 
-    int mergeLabels(const LabelMap& map);
     int resolve(strvec_t& modules);
+
+    // Checks that the SymbolAttributes of sym are known, that its
+    // masks only name registers that are passed to a symbol, and
+    // that a pure symbol also sets SA_NMEM, SA_RMSK and SA_WMSK.
+    static bool isValidSymbol(const SymbolTable& sym);
+
+    // Every symbol found by resolve, and the module it is in.
+    const StringLookup& getSymbols(void) const
+    {
+        return m_symbols;
+    }
+
+    // Flushes the file to the device when it is closed.
+    void setSync(bool sync);
+
     int open(const char* fname);
+
+    // With a file open, writeHeader sizes it to the whole image
+    // and maps it, so writeSections copies each section straight
+    // into the file. Otherwise the image is built in memory.
+    // Either way, this finishes the file.
+    int close(void);
+
+    // The whole image once writeSections returns, when no file
+    // was open. It can be used to compile in memory.
+    const MemoryStream& getImage(void) const
+    {
+        return m_image;
+    }
     int writeHeader(void);
     int writeSections(void);
 };
@@ -29,25 +29,51 @@
 #include <algorithm>
 #include <cassert>
 
-BlockReader::BlockReader(const char *fname) :
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+BlockReader::BlockReader(const char *fname, int mode) :
     m_block(nullptr),
     m_fileLen(0),
-    m_loc(0)
+    m_loc(0),
+    m_mapped(false)
 {
-    open(fname);
+    open(fname, mode);
 }
 
 BlockReader::BlockReader() :
     m_block(nullptr),
     m_fileLen(0),
-    m_loc(0)
+    m_loc(0),
+    m_mapped(false)
 {
 }
 
 BlockReader::~BlockReader()
+{
+    release();
+}
+
+void BlockReader::release(void)
 {
     if (m_block)
-        delete[] m_block;
+    {
+#ifndef _WIN32
+        if (m_mapped)
+            munmap(m_block, m_fileLen);
+        else
+#endif
+            delete[] m_block;
+    }
+
+    m_block   = nullptr;
+    m_fileLen = 0;
+    m_loc     = 0;
+    m_mapped  = false;
 }
 
 uint8_t BlockReader::next(void)
@@ -101,18 +127,72 @@ void BlockReader::moveTo(size_t loc)
         m_loc = loc;
 }
 
-void BlockReader::open(const char *fname)
+void BlockReader::discard(size_t loc, size_t nr)
 {
+#ifndef _WIN32
+    if (!m_mapped || loc >= m_fileLen)
+        return;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t st   = (loc + page - 1) / page * page;
+    size_t en   = std::min(loc + nr, m_fileLen) / page * page;
+
+    if (st < en)
+        madvise(m_block + st, en - st, MADV_DONTNEED);
+#endif
+}
+
+bool BlockReader::map(const char *fname)
+{
+#ifndef _WIN32
+    int fd = ::open(fname, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // The mapping is private and read only, so every reader
+    // of the same file shares the page cache instead of
+    // holding its own copy.
+    size_t len = (size_t)st.st_size;
+    void  *mem = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED)
+        return false;
+
+    madvise(mem, len, MADV_SEQUENTIAL);
+    madvise(mem, len, MADV_WILLNEED);
+
+    m_block   = (uint8_t *)mem;
+    m_fileLen = len;
+    m_mapped  = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void BlockReader::open(const char *fname, int mode)
+{
+    release();
+
     if (fname)
     {
+        if (mode == BRM_MAPPED && map(fname))
+            return;
+
         FILE *fp = fopen(fname, "rb");
         if (fp)
         {
             fseek(fp, 0L, SEEK_END);
             m_fileLen = ftell(fp);
             fseek(fp, 0L, SEEK_SET);
-            if (m_block)
-                delete[] m_block;
 
             m_block = new uint8_t[m_fileLen + 1];
             fread(m_block, 1, m_fileLen, fp);
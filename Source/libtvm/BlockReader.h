@@ -25,25 +25,57 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+enum BlockReaderMode
+{
+    BRM_BUFFERED,  // read the whole file into a heap block
+    BRM_MAPPED,    // map the file, falling back to BRM_BUFFERED
+};
+
 class BlockReader
 {
 private:
     uint8_t *m_block;
     size_t   m_fileLen;
     size_t   m_loc;
+    bool     m_mapped;
+
+    bool map(const char *fname);
+    void release(void);
 
 public:
-    BlockReader(const char *fname);
+    BlockReader(const char *fname, int mode = BRM_MAPPED);
     BlockReader();
     ~BlockReader();
 
-    void    open(const char *fname);
+    void    open(const char *fname, int mode = BRM_MAPPED);
     uint8_t next(void);
     uint8_t current(void);
     size_t  read(void *blk, size_t nr);
     void    offset(int32_t nr);
     void    moveTo(size_t loc);
 
+    // Moves forward nr bytes, stopping at the end of the file.
+    void skip(size_t nr)
+    {
+        m_loc = nr < m_fileLen - m_loc ? m_loc + nr : m_fileLen;
+    }
+
+    // The bytes from the current location to the end of the file.
+    const uint8_t *cursor(void) const
+    {
+        return m_block + m_loc;
+    }
+
+    size_t remaining(void) const
+    {
+        return m_fileLen - m_loc;
+    }
+
+    // Releases the mapped pages that lie entirely inside of
+    // [loc, loc + nr). They are read from the file again if
+    // they are used later. It has no effect on a buffered file.
+    void discard(size_t loc, size_t nr);
+
     const uint8_t *ptr(void) const
     {
         return m_block;
@@ -54,6 +86,11 @@ public:
         return m_loc >= m_fileLen;
     }
 
+    inline bool mapped(void) const
+    {
+        return m_mapped;
+    }
+
     inline size_t tell(void) const
     {
         return m_loc;
@@ -0,0 +1,308 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "CompileCache.h"
+#include <stdio.h>
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+struct CompileCacheCounts
+{
+    uint8_t  code[2];
+    uint16_t version;
+    uint32_t reserved;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evicted;
+};
+
+struct CompileCacheEntry
+{
+    fs::file_time_type time;
+    uint64_t           size;
+    fs::path           path;
+
+    bool operator<(const CompileCacheEntry& rhs) const
+    {
+        return time < rhs.time;
+    }
+};
+
+using CompileCacheEntries = std::vector<CompileCacheEntry>;
+
+const char* const EntryExtension = ".tvi";
+const char* const CountsName     = "stats.tvs";
+
+inline uint64_t findEntries(const str_t& dir, CompileCacheEntries& dest)
+{
+    std::error_code ec;
+    uint64_t        total = 0;
+
+    fs::directory_iterator it(dir, ec), end;
+    for (; !ec && it != end; it.increment(ec))
+    {
+        if (!it->is_regular_file(ec) || it->path().extension() != EntryExtension)
+            continue;
+
+        CompileCacheEntry ent;
+        ent.path = it->path();
+        ent.size = (uint64_t)it->file_size(ec);
+        ent.time = it->last_write_time(ec);
+        if (ec)
+        {
+            // it was removed by another process
+            ec.clear();
+            continue;
+        }
+
+        total += ent.size;
+        dest.push_back(ent);
+    }
+    return total;
+}
+
+CompileCache::CompileCache() :
+    m_dir(),
+    m_limit(CC_DEFAULT_LIMIT),
+    m_link(false)
+{
+}
+
+CompileCache::~CompileCache()
+{
+}
+
+void CompileCache::setDirectory(const str_t& dir)
+{
+    m_dir = dir;
+    if (!m_dir.empty() && m_dir.back() != '/' && m_dir.back() != '\\')
+        m_dir.push_back('/');
+
+    std::error_code ec;
+    if (!m_dir.empty())
+        fs::create_directories(m_dir, ec);
+}
+
+void CompileCache::setLimit(uint64_t bytes)
+{
+    m_limit = bytes;
+}
+
+void CompileCache::setLinking(bool link)
+{
+    m_link = link;
+}
+
+void CompileCache::makePath(str_t& dest, const CompileCacheKey& key)
+{
+    char buf[SHA256_SIZE * 2 + 64];
+
+    size_t i;
+    for (i = 0; i < SHA256_SIZE; ++i)
+        snprintf(buf + i * 2, 3, "%02x", key.source[i]);
+
+    snprintf(buf + SHA256_SIZE * 2,
+             sizeof buf - SHA256_SIZE * 2,
+             "-%llx-%016llx",
+             (unsigned long long)key.size,
+             (unsigned long long)key.config);
+
+    dest = m_dir;
+    dest += buf;
+    dest += EntryExtension;
+}
+
+void CompileCache::release(const char* fname)
+{
+    std::error_code ec;
+    if (fs::is_regular_file(fname, ec))
+        fs::remove(fname, ec);
+}
+
+void CompileCache::count(uint64_t hits, uint64_t misses, uint64_t evicted)
+{
+    // Concurrent compiles can lose an update here. The
+    // counts are only a guide, so that is not worth a lock.
+    str_t path = m_dir + CountsName;
+
+    CompileCacheCounts counts = {};
+
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp)
+    {
+        if (fread(&counts, 1, sizeof counts, fp) != sizeof counts ||
+            counts.code[0] != 'T' || counts.code[1] != 'S' ||
+            counts.version != CC_VERSION)
+            counts = {};
+        fclose(fp);
+    }
+
+    counts.code[0] = 'T';
+    counts.code[1] = 'S';
+    counts.version = CC_VERSION;
+    counts.hits += hits;
+    counts.misses += misses;
+    counts.evicted += evicted;
+
+    fp = fopen(path.c_str(), "wb");
+    if (fp)
+    {
+        fwrite(&counts, 1, sizeof counts, fp);
+        fclose(fp);
+    }
+}
+
+int CompileCache::fetch(const CompileCacheKey& key, const char* fname)
+{
+    if (!enabled())
+        return PS_UNDEFINED;
+
+    str_t path;
+    makePath(path, key);
+
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec))
+    {
+        count(0, 1, 0);
+        return PS_UNDEFINED;
+    }
+
+    release(fname);
+
+    if (m_link)
+        fs::create_hard_link(path, fname, ec);
+    if (!m_link || ec)
+    {
+        ec.clear();
+        fs::copy_file(path, fname, fs::copy_options::overwrite_existing, ec);
+    }
+
+    if (ec)
+    {
+        count(0, 1, 0);
+        return PS_UNDEFINED;
+    }
+
+    // mark it as recently used
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    count(1, 0, 0);
+    return PS_OK;
+}
+
+int CompileCache::store(const CompileCacheKey& key, const char* fname)
+{
+    if (!enabled())
+        return PS_UNDEFINED;
+
+    str_t path, temp;
+    makePath(path, key);
+
+    // Copy to a temporary file first, so that another
+    // process never sees a partial entry.
+    char buf[32];
+    snprintf(buf, sizeof buf, ".%d", (int)getpid());
+    temp = path + buf;
+
+    std::error_code ec;
+    fs::copy_file(fname, temp, fs::copy_options::overwrite_existing, ec);
+    if (!ec)
+        fs::rename(temp, path, ec);
+
+    if (ec)
+    {
+        fs::remove(temp, ec);
+        return PS_ERROR;
+    }
+
+    evict();
+    return PS_OK;
+}
+
+void CompileCache::evict(void)
+{
+    CompileCacheEntries entries;
+
+    uint64_t total = findEntries(m_dir, entries);
+    if (total <= m_limit)
+        return;
+
+    // oldest first
+    std::sort(entries.begin(), entries.end());
+
+    uint64_t evicted = 0;
+
+    CompileCacheEntries::iterator it = entries.begin();
+    for (; it != entries.end() && total > m_limit; ++it)
+    {
+        std::error_code ec;
+        if (fs::remove(it->path, ec))
+        {
+            total -= it->size;
+            ++evicted;
+        }
+    }
+
+    if (evicted > 0)
+        count(0, 0, evicted);
+}
+
+int CompileCache::stats(CompileCacheStats& dest)
+{
+    dest = {};
+    if (!enabled())
+        return PS_UNDEFINED;
+
+    str_t path = m_dir + CountsName;
+
+    CompileCacheCounts counts = {};
+
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp)
+    {
+        if (fread(&counts, 1, sizeof counts, fp) == sizeof counts &&
+            counts.code[0] == 'T' && counts.code[1] == 'S' &&
+            counts.version == CC_VERSION)
+        {
+            dest.hits    = counts.hits;
+            dest.misses  = counts.misses;
+            dest.evicted = counts.evicted;
+        }
+        fclose(fp);
+    }
+
+    CompileCacheEntries entries;
+    dest.bytes   = findEntries(m_dir, entries);
+    dest.entries = entries.size();
+    return PS_OK;
+}
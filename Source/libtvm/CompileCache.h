@@ -0,0 +1,99 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _CompileCache_h_
+#define _CompileCache_h_
+
+#include <stdint.h>
+#include "Declarations.h"
+#include "Sha256.h"
+
+// Changes whenever tcom can produce different output from the
+// same input, so that entries from older builds are not used.
+#define CC_VERSION 2
+
+// The default size limit of the cache in bytes.
+#define CC_DEFAULT_LIMIT (256ULL << 20)
+
+struct CompileCacheKey
+{
+    uint8_t  source[SHA256_SIZE];  // SHA-256 of each input's size and bytes, in order
+    uint64_t size;                 // combined size of the input files
+    uint64_t config;               // hash of the options, modules, their symbols and CC_VERSION
+};
+
+struct CompileCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evicted;  // entries removed to stay under the limit
+    uint64_t entries;
+    uint64_t bytes;
+};
+
+// Keeps the output of earlier compiles by the content of their
+// inputs. Each entry is the output file itself, so a hit is a
+// copy, or a hard link when linking is enabled. The least
+// recently used entries are removed once the cache grows past
+// its limit.
+class CompileCache
+{
+private:
+    str_t    m_dir;
+    uint64_t m_limit;
+    bool     m_link;
+
+    void makePath(str_t& dest, const CompileCacheKey& key);
+    void count(uint64_t hits, uint64_t misses, uint64_t evicted);
+    void evict(void);
+
+public:
+    CompileCache();
+    ~CompileCache();
+
+    void setDirectory(const str_t& dir);
+    void setLimit(uint64_t bytes);
+
+    // Hard links hits to the entry rather than copying it. The
+    // output then shares its contents with the cache, so it must
+    // be replaced rather than rewritten in place.
+    void setLinking(bool link);
+
+    bool enabled(void) const
+    {
+        return !m_dir.empty();
+    }
+
+    // Places the entry for key at fname. Returns PS_OK on a
+    // hit and PS_UNDEFINED on a miss.
+    int fetch(const CompileCacheKey& key, const char* fname);
+
+    // Adds fname as the entry for key, then evicts.
+    int store(const CompileCacheKey& key, const char* fname);
+
+    int stats(CompileCacheStats& dest);
+
+    // Removes fname if it is a regular file, so writing to
+    // it can never change a linked entry.
+    static void release(const char* fname);
+};
+
+#endif  //_CompileCache_h_
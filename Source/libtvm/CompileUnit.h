@@ -0,0 +1,45 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _CompileUnit_h_
+#define _CompileUnit_h_
+
+#include "Arena.h"
+#include "Declarations.h"
+#include "StringTable.h"
+
+// Everything that is parsed from one file. Label and symbol names
+// are interned once in names, and the instructions, data and info
+// refer to them by index. Index zero is always the empty string.
+//
+// A unit can be moved without copying its instructions or strings,
+// so it is handed from the parser to the writer as a whole.
+struct CompileUnit
+{
+    StringTable      names;
+    NameInfos        info;    // indexed by name
+    Instructions     ins;
+    DataDeclarations data;
+    Arena            strings;  // string values and escaped tokens
+    uint64_t         labels;   // the number of labels
+};
+
+#endif  //_CompileUnit_h_
@@ -26,9 +26,11 @@
 #include <set>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include "ArrayStack.h"
+#include "PageMemory.h"
 #include "SharedLib.h"
 
 #define INS_ARG 3
@@ -38,6 +40,9 @@
 // Maximum number of branches present at one time
 #define MAX_STK 256
 
+// An index or address that has not been resolved
+#define NO_INDEX ((uint64_t)-1)
+
 typedef std::string        str_t;
 typedef std::vector<str_t> strvec_t;
 typedef std::set<str_t>    strset_t;
@@ -78,25 +83,41 @@ enum ProgramFlags
     PF_L = 1 << 2,
 };
 
+// The value of a token is a slice of the source being parsed, or of
+// the parser's arena for strings that contain escape sequences. It
+// is valid until the parser opens another file.
 struct Token
 {
-    uint8_t  op;
-    uint8_t  reg;
-    uint16_t regtype;
-    uint16_t sectype;
-    Register ival;
-    int32_t  type;
-    str_t    value;
-    int32_t  index;
-    bool     hasComma;
+    uint8_t          op;
+    uint8_t          reg;
+    uint16_t         regtype;
+    uint16_t         sectype;
+    Register         ival;
+    int32_t          type;
+    std::string_view value;
+    int32_t          index;
+    bool             hasComma;
 };
 
+using DataValues = std::vector<uint64_t>;
+
 struct DataDeclaration
 {
-    str_t    lname;
-    uint16_t type;
-    str_t    sval;
-    uint64_t ival;
+    uint32_t         name;      // the interned name of the declaration
+    uint16_t         type;
+    std::string_view sval;      // held by the arena of its CompileUnit
+    uint64_t         ival;
+    DataValues       values;    // every element of an integer declaration
+    bool             readonly;  // declared in a .rodata section
+};
+
+// What an interned name refers to. Names are interned by the
+// parser and referred to by their index, where index zero is
+// the empty string. So a zero initialized name is no name.
+struct NameInfo
+{
+    uint64_t label;  // the label index, or zero if it is not a label
+    uint32_t data;   // index + 1 of the data declaration, or zero
 };
 
 enum ParseResult
@@ -205,6 +226,7 @@ enum SectionCodes
     // File sections
     SEC_DAT = 0xFF,
     SEC_TXT,
+    SEC_ROD,
     // Data sections
     SEC_DECL_ST,
     SEC_ASCII,  // .asciz
@@ -232,24 +254,86 @@ enum InstructionFlags
                        // x = default, if not present
     IF_RIDX = 0x0800,  // [r(n), idx < 256]
     IF_MAXF = 0x1000,  // needs an uint16_t
+    IF_BTEQ = 0x2000,  // q uint64_t, the same as x outside of ldrs and strs
 };
 
+enum TVMHeaderFlags
+{
+    // The code section stores ExecInstructions as they
+    // are laid out in memory, so it can run in place.
+    HF_FIXED = 0x0001,
+    // A function index section follows the header.
+    HF_FUNC = 0x0002,
+    // The string section is laid out as a StringTable.
+    HF_STRIDX = 0x0004,
+    // The symbol section holds an import table.
+    HF_IMPORT = 0x0008,
+    // A BSS section follows the data section. It only
+    // has a size, and is addressed after the data.
+    HF_BSS = 0x0010,
+    // A read-only data section follows the data and BSS
+    // sections. Its start field holds the address of its
+    // first byte, which is past the end of the BSS.
+    HF_RODATA = 0x0020,
+    // The code and data sections are compressed when it
+    // makes them smaller. Each one that is has SF_LZ set.
+    HF_LZ = 0x0040,
+};
+
+enum TVMSectionFlags
+{
+    // The section holds a uint64_t length followed by that many
+    // bytes of LZCodec output. The size field is the expanded size.
+    SF_LZ = 0x0001,
+};
+
+// The version of the header and section layout. Offsets and
+// sizes were 32 bits before version 2.
+#define TVM_VERSION 2
+
 struct TVMHeader
 {
     uint8_t  code[2];
     uint16_t flags;
-    uint32_t dat;
-    uint32_t str;
-    uint32_t sym;
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t dat;
+    uint64_t str;
+    uint64_t sym;
 };
 
 struct TVMSection
 {
     uint16_t flags;
     uint16_t align;
-    uint32_t entry;
-    uint32_t size;
-    uint32_t start;
+    uint32_t reserved;
+    uint64_t entry;
+    uint64_t size;
+    uint64_t start;
+};
+
+static_assert(sizeof(TVMHeader) == 32, "the header layout changed");
+static_assert(sizeof(TVMSection) == 32, "the section layout changed");
+
+// Function index entry. The section starts with a uint64_t
+// count of entries, and the names follow the entries as
+// null terminated strings.
+struct TVMFunction
+{
+    uint32_t start;   // index of the first instruction
+    uint32_t count;   // number of instructions
+    uint32_t offset;  // byte offset of the first instruction in the code section
+    uint32_t name;    // byte offset of the name, from the end of the entries
+};
+
+// Import table entry. When HF_IMPORT is set, the symbol section
+// is a uint32_t library count, a uint32_t import count, the
+// entries, then the null terminated library names. Native calls
+// store the index of their entry in argv[0].
+struct TVMImport
+{
+    uint32_t library;  // index of the library in the symbol section
+    uint32_t name;     // index of the symbol name in the string table
 };
 
 struct Instruction
@@ -259,42 +343,105 @@ struct Instruction
     uint16_t flags;
     uint16_t sizes;
     uint8_t  index;
+    uint32_t name;  // the label or symbol operand, zero if there is none
     uint64_t argv[INS_ARG];
     uint64_t label;
     uint64_t sym;
-    str_t    lname;
 };
 
 typedef void (*Symbol)(tvmregister_t);
 
+#define SYM_REG(n) ((uint16_t)(1 << (n)))
+
+// The registers that are passed to a symbol, x0 through x8.
+#define SYM_REGS ((uint16_t)(SYM_REG(MAX_REG - 1) - 1))
+
+enum SymbolAttributes
+{
+    // By default a symbol is assumed to read and write
+    // every register it is passed, the data section and
+    // global state.
+    SA_NONE = 0x00,
+    SA_RMSK = 0x01,  // reads are limited to the registers in SymbolTable::reads
+    SA_WMSK = 0x02,  // writes are limited to the registers in SymbolTable::writes
+    SA_PURE = 0x04,  // the result depends only on the registers it reads
+    SA_NMEM = 0x08,  // does not access the data section or any global memory
+    SA_SAFE = 0x10,  // may be called from more than one thread
+    SA_MASK = 0x1F,
+    SA_PREQ = 0x0F,  // the attributes that SA_PURE is only valid with
+};
+
 struct SymbolTable
 {
     const char* name;
     Symbol      callback;
+    uint16_t    attributes;
+    uint16_t    reads;   // SYM_REG(n) mask, valid with SA_RMSK
+    uint16_t    writes;  // SYM_REG(n) mask, valid with SA_WMSK
 };
 
 typedef SymbolTable* (*ModuleInit)();
 
+// The last registers a pure symbol was called with, and
+// the registers it returned for them.
+struct SymbolMemo
+{
+    bool      valid;
+    Registers in;
+    Registers out;
+};
+
+struct ModuleTable
+{
+    const SymbolTable* symbols;  // the table returned from <module>_init
+    uint32_t           count;
+};
+
+// This is also the layout of an HF_FIXED code section,
+// so it cannot hold any pointers. Native calls store the
+// program's symbol slot in argv[0] instead.
 struct ExecInstruction
 {
     uint8_t  op;
     uint8_t  argc;
     uint16_t flags;
-    uint64_t argv[INS_ARG];
     uint16_t index;
-    Symbol   call;
+    uint16_t reserved;
+    uint64_t argv[INS_ARG];
 };
 
+static_assert(sizeof(ExecInstruction) == 32, "the fixed code layout changed");
+
 using Instructions     = std::vector<Instruction>;
 using IndexToPosition  = std::unordered_map<uint64_t, uint64_t>;
-using LabelMap         = std::unordered_map<str_t, uint64_t>;
-using SymbolMap        = std::unordered_map<str_t, Symbol>;
+using SymbolMap        = std::unordered_map<str_t, SymbolTable>;
+using SymbolSlots      = std::vector<const SymbolTable*>;
+using SymbolMemos      = std::vector<SymbolMemo>;
+using ModuleTables     = std::vector<ModuleTable>;
 using StringLookup     = std::unordered_map<str_t, str_t>;
 using AddressLookup    = std::unordered_map<str_t, uint64_t>;
 using DynamicLib       = std::vector<void*>;
 using StringMap        = std::unordered_map<str_t, uint64_t>;
-using ExecInstructions = std::vector<ExecInstruction>;
-using DataLookup       = std::unordered_map<str_t, DataDeclaration>;
+using ExecInstructions = std::vector<ExecInstruction, PageAllocator<ExecInstruction>>;
+using TVMFunctions     = std::vector<TVMFunction>;
+using TVMImports       = std::vector<TVMImport>;
+using DataDeclarations = std::vector<DataDeclaration>;
+using NameInfos        = std::vector<NameInfo>;
+using LabelAddresses   = std::vector<uint64_t>;
+
+// A range of instructions that is decoded or verified by one task.
+struct CodeChunk
+{
+    size_t              first;    // index of the first instruction
+    size_t              count;    // number of instructions
+    size_t              offset;   // byte offset of the first instruction
+    size_t              end;      // byte offset past the last instruction
+    size_t              fail;     // index of the instruction that failed
+    const char*         error;    // why it failed, or nullptr
+    std::vector<size_t> symbols;  // native calls before the failure
+};
+
+using CodeChunks = std::vector<CodeChunk>;
 
 #define _TIME_CHECK_BEGIN                                             \
     {                                                                 \
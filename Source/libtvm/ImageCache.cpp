@@ -0,0 +1,189 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "ImageCache.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+
+inline uint64_t rotate(uint64_t v, int n)
+{
+    return (v << n) | (v >> (64 - n));
+}
+
+inline uint64_t mix(uint64_t h, uint64_t k)
+{
+    k *= Prime2;
+    k = rotate(k, 31);
+    k *= Prime1;
+    h ^= k;
+    return rotate(h, 27) * Prime1 + Prime3;
+}
+
+ImageCache::ImageCache() :
+    m_dir()
+{
+}
+
+ImageCache::~ImageCache()
+{
+}
+
+void ImageCache::setDirectory(const str_t& dir)
+{
+    m_dir = dir;
+    if (!m_dir.empty() && m_dir.back() != '/' && m_dir.back() != '\\')
+        m_dir.push_back('/');
+}
+
+void ImageCache::makePath(str_t& dest, const ImageCacheKey& key)
+{
+    char buf[SHA256_SIZE * 2 + 1];
+
+    int i;
+    for (i = 0; i < SHA256_SIZE; ++i)
+        snprintf(buf + i * 2, 3, "%02x", key.digest[i]);
+
+    dest = m_dir;
+    dest += buf;
+    dest += ".tvc";
+}
+
+uint64_t ImageCache::hash(const void* block, size_t len, uint64_t seed)
+{
+    const uint8_t* ptr = (const uint8_t*)block;
+    uint64_t       h   = seed + Prime3 + (uint64_t)len * Prime1;
+    uint64_t       k;
+
+    // consume the block a word at a time
+    while (len >= 8)
+    {
+        memcpy(&k, ptr, 8);
+        h = mix(h, k);
+        ptr += 8;
+        len -= 8;
+    }
+
+    if (len > 0)
+    {
+        k = 0;
+        memcpy(&k, ptr, len);
+        h = mix(h, k);
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+int ImageCache::find(const ImageCacheKey& key, ImageCacheSlots& slots)
+{
+    if (!enabled())
+        return PS_UNDEFINED;
+
+    str_t path;
+    makePath(path, key);
+
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp)
+        return PS_UNDEFINED;
+
+    int              status = PS_OK;
+    ImageCacheHeader header = {};
+    if (fread(&header, 1, sizeof(ImageCacheHeader), fp) != sizeof(ImageCacheHeader))
+        status = PS_UNDEFINED;
+    else if (header.code[0] != 'T' || header.code[1] != 'C' || header.version != IC_VERSION)
+        status = PS_UNDEFINED;
+    else if (memcmp(&header.key, &key, sizeof(ImageCacheKey)) != 0)
+        status = PS_UNDEFINED;
+    else
+    {
+        slots.resize(header.slots);
+
+        size_t len = slots.size() * sizeof(ImageCacheSlot);
+        if (len > 0 && fread(slots.data(), 1, len, fp) != len)
+            status = PS_UNDEFINED;
+    }
+
+    if (status != PS_OK)
+        slots.clear();
+
+    fclose(fp);
+    return status;
+}
+
+int ImageCache::store(const ImageCacheKey& key, const ImageCacheSlots& slots)
+{
+    if (!enabled())
+        return PS_UNDEFINED;
+
+    str_t path, temp;
+    makePath(path, key);
+
+    // Write to a temporary file first, so that another process
+    // never sees a partial record.
+    char buf[32];
+    snprintf(buf, sizeof buf, ".%d", (int)getpid());
+    temp = path + buf;
+
+    FILE* fp = fopen(temp.c_str(), "wb");
+    if (!fp)
+        return PS_ERROR;
+
+    ImageCacheHeader header = {};
+    header.code[0]          = 'T';
+    header.code[1]          = 'C';
+    header.version          = IC_VERSION;
+    header.slots            = (uint32_t)slots.size();
+    header.key              = key;
+
+    size_t len = slots.size() * sizeof(ImageCacheSlot);
+    bool   ok  = fwrite(&header, 1, sizeof(ImageCacheHeader), fp) == sizeof(ImageCacheHeader);
+    if (ok && len > 0)
+        ok = fwrite(slots.data(), 1, len, fp) == len;
+
+    ok = fclose(fp) == 0 && ok;
+    if (ok)
+        ok = rename(temp.c_str(), path.c_str()) == 0;
+
+    if (!ok)
+    {
+        remove(temp.c_str());
+        return PS_ERROR;
+    }
+    return PS_OK;
+}
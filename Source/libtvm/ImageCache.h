@@ -0,0 +1,88 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _ImageCache_h_
+#define _ImageCache_h_
+
+#include <stdint.h>
+#include <vector>
+#include "Declarations.h"
+#include "Sha256.h"
+
+#define IC_VERSION 2
+
+// Marks a slot that was never resolved.
+#define IC_UNUSED 0xFFFF
+
+struct ImageCacheKey
+{
+    uint8_t  digest[SHA256_SIZE];  // SHA-256 of the whole image
+    uint64_t size;                 // size of the image in bytes
+    uint64_t modules;              // combined stamp of every linked module
+};
+
+struct ImageCacheHeader
+{
+    uint8_t       code[2];
+    uint16_t      version;
+    uint32_t      slots;
+    ImageCacheKey key;
+};
+
+struct ImageCacheSlot
+{
+    uint16_t module;  // index of the module in the image's symbol table
+    uint16_t reserved;
+    uint32_t index;  // index into the module's initialization table
+};
+
+using ImageCacheSlots = std::vector<ImageCacheSlot>;
+
+// Records images that have already passed verification, along with
+// where each of their native calls resolved. A record is only used
+// when the image bytes and every linked module still match the key.
+// Since a hit skips verification, the image is keyed by a
+// cryptographic digest rather than by ImageCache::hash.
+class ImageCache
+{
+private:
+    str_t m_dir;
+
+    void makePath(str_t& dest, const ImageCacheKey& key);
+
+public:
+    ImageCache();
+    ~ImageCache();
+
+    void setDirectory(const str_t& dir);
+
+    bool enabled(void) const
+    {
+        return !m_dir.empty();
+    }
+
+    int find(const ImageCacheKey& key, ImageCacheSlots& slots);
+    int store(const ImageCacheKey& key, const ImageCacheSlots& slots);
+
+    static uint64_t hash(const void* block, size_t len, uint64_t seed = 0);
+};
+
+#endif  //_ImageCache_h_
@@ -19,24 +19,25 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
+#include <array>
 #include "Declarations.h"
 
-const uint8_t    nullarg[3]  = {0xFF, 0xFF, 0xFF};
-const KeywordMap NullKeyword = {{'\0'}, OP_MAX, 0, nullarg};
-
-const uint8_t ArgTypeStd1[3] = {AT_REGI, AT_RVAL, AT_NULL};
-const uint8_t ArgTypeStd2[3] = {AT_RVAL, AT_RVAL, AT_NULL};
-const uint8_t ArgTypeStd3[3] = {AT_RVAL, AT_NULL, AT_NULL};
-const uint8_t ArgTypeStd4[3] = {AT_REGI, AT_RVAL, AT_RVAL};
-const uint8_t ArgTypeStd5[3] = {AT_REGI, AT_ADDR, AT_NULL};
-const uint8_t ArgTypeStd6[3] = {AT_REGI, AT_RVAL, AT_RVAA};
-const uint8_t ArgTypeStd7[3] = {AT_REGI, AT_RIDX, AT_NULL};
-const uint8_t ArgTypeStd8[3] = {AT_REGI, AT_SVAL, AT_NULL};
-const uint8_t ArgTypeReg1[3] = {AT_REGI, AT_NULL, AT_NULL};
-const uint8_t ArgTypeAdr1[3] = {AT_ADDR, AT_NULL, AT_NULL};
-const uint8_t ArgTypeNone[3] = {AT_REGI, AT_RVAL, AT_NULL};
-
-const KeywordMap KeywordTable[] = {
+constexpr uint8_t    nullarg[3]  = {0xFF, 0xFF, 0xFF};
+constexpr KeywordMap NullKeyword = {{'\0'}, OP_MAX, 0, nullarg};
+
+constexpr uint8_t ArgTypeStd1[3] = {AT_REGI, AT_RVAL, AT_NULL};
+constexpr uint8_t ArgTypeStd2[3] = {AT_RVAL, AT_RVAL, AT_NULL};
+constexpr uint8_t ArgTypeStd3[3] = {AT_RVAL, AT_NULL, AT_NULL};
+constexpr uint8_t ArgTypeStd4[3] = {AT_REGI, AT_RVAL, AT_RVAL};
+constexpr uint8_t ArgTypeStd5[3] = {AT_REGI, AT_ADDR, AT_NULL};
+constexpr uint8_t ArgTypeStd6[3] = {AT_REGI, AT_RVAL, AT_RVAA};
+constexpr uint8_t ArgTypeStd7[3] = {AT_REGI, AT_RIDX, AT_NULL};
+constexpr uint8_t ArgTypeStd8[3] = {AT_REGI, AT_SVAL, AT_NULL};
+constexpr uint8_t ArgTypeReg1[3] = {AT_REGI, AT_NULL, AT_NULL};
+constexpr uint8_t ArgTypeAdr1[3] = {AT_ADDR, AT_NULL, AT_NULL};
+constexpr uint8_t ArgTypeNone[3] = {AT_REGI, AT_RVAL, AT_NULL};
+
+constexpr KeywordMap KeywordTable[] = {
     {"mov\0 ", OP_MOV, 2, ArgTypeStd1},
     {"bl\0  ", OP_GTO, 1, ArgTypeAdr1},
     {"ret\0 ", OP_RET, 0, ArgTypeNone},
@@ -69,4 +70,138 @@ const KeywordMap KeywordTable[] = {
     //  ---- debugging ----
 };
 
-const size_t KeywordTableSize = sizeof(KeywordTable) / sizeof(KeywordMap);
+constexpr size_t KeywordTableSize = sizeof(KeywordTable) / sizeof(KeywordMap);
+
+// Every word that the parser classifies by its spelling, the
+// keywords and the register names, is found with a perfect hash
+// that is built from these tables when the parser is compiled.
+
+enum LexemeType
+{
+    LT_KEYWORD,   // value is the index in KeywordTable
+    LT_REGISTER,  // value is the register number
+};
+
+struct Lexeme
+{
+    Keyword  word;
+    uint8_t  len;
+    uint8_t  type;
+    uint8_t  value;
+    uint16_t regtype;
+};
+
+constexpr char    RegisterPrefix[] = {'x', 'b', 'w', 'l', 'q'};
+constexpr size_t  RegisterPrefixes = sizeof(RegisterPrefix);
+constexpr size_t  LexemeCount      = KeywordTableSize + RegisterPrefixes * MAX_REG + 2;
+constexpr size_t  LexemeTableSize  = 1024;
+constexpr uint8_t LexemeNone       = 0xFF;
+
+static_assert(LexemeCount < LexemeNone, "the lexeme index needs more bits");
+
+using Lexemes     = std::array<Lexeme, LexemeCount>;
+using LexemeTable = std::array<uint8_t, LexemeTableSize>;
+
+constexpr uint16_t getRegisterType(char prefix)
+{
+    return prefix == 'b'   ? IF_BTEB
+           : prefix == 'w' ? IF_BTEW
+           : prefix == 'l' ? IF_BTEL
+           : prefix == 'q' ? IF_BTEQ
+                           : 0;
+}
+
+constexpr Lexemes makeLexemes(void)
+{
+    Lexemes ent = {};
+    size_t  n = 0, i = 0, j = 0;
+
+    for (i = 0; i < KeywordTableSize; ++i, ++n)
+    {
+        for (j = 0; j < MAX_KWD && KeywordTable[i].word[j] != 0; ++j)
+            ent[n].word[j] = KeywordTable[i].word[j];
+        ent[n].len   = (uint8_t)j;
+        ent[n].type  = LT_KEYWORD;
+        ent[n].value = (uint8_t)i;
+    }
+
+    for (i = 0; i < RegisterPrefixes; ++i)
+    {
+        for (j = 0; j < MAX_REG; ++j, ++n)
+        {
+            ent[n].word[0] = RegisterPrefix[i];
+            ent[n].word[1] = (char)('0' + j);
+            ent[n].len     = 2;
+            ent[n].type    = LT_REGISTER;
+            ent[n].value   = (uint8_t)j;
+            ent[n].regtype = getRegisterType(RegisterPrefix[i]);
+        }
+    }
+
+    ent[n++] = {{'s', 'p'}, 2, LT_REGISTER, 0, IF_STKP};
+    ent[n++] = {{'p', 'c'}, 2, LT_REGISTER, 0, IF_INSP};
+    return ent;
+}
+
+constexpr uint32_t hashLexeme(const char* str, size_t len, uint32_t seed)
+{
+    uint32_t h = seed;
+    size_t   i = 0;
+    for (i = 0; i < len; ++i)
+        h = (h ^ (uint8_t)str[i]) * 0x01000193;
+    return (h ^ (h >> 15)) & (LexemeTableSize - 1);
+}
+
+// Returns the first seed that gives every lexeme its own slot.
+constexpr uint32_t findLexemeSeed(const Lexemes& ent)
+{
+    uint32_t seed = 1;
+    for (;; ++seed)
+    {
+        std::array<bool, LexemeTableSize> used = {};
+
+        size_t i = 0;
+        for (; i < ent.size(); ++i)
+        {
+            uint32_t slot = hashLexeme(ent[i].word, ent[i].len, seed);
+            if (used[slot])
+                break;
+            used[slot] = true;
+        }
+
+        if (i == ent.size())
+            return seed;
+    }
+}
+
+constexpr LexemeTable makeLexemeTable(const Lexemes& ent, uint32_t seed)
+{
+    LexemeTable table = {};
+
+    size_t i = 0;
+    for (i = 0; i < table.size(); ++i)
+        table[i] = LexemeNone;
+    for (i = 0; i < ent.size(); ++i)
+        table[hashLexeme(ent[i].word, ent[i].len, seed)] = (uint8_t)i;
+    return table;
+}
+
+constexpr Lexemes     LexemeList  = makeLexemes();
+constexpr uint32_t    LexemeSeed  = findLexemeSeed(LexemeList);
+constexpr LexemeTable LexemeSlots = makeLexemeTable(LexemeList, LexemeSeed);
+
+// Returns the keyword or register spelled by str, or nullptr.
+inline const Lexeme* findLexeme(const char* str, size_t len)
+{
+    if (len == 0 || len > MAX_KWD)
+        return nullptr;
+
+    uint8_t idx = LexemeSlots[hashLexeme(str, len, LexemeSeed)];
+    if (idx == LexemeNone)
+        return nullptr;
+
+    const Lexeme& ent = LexemeList[idx];
+    if (ent.len != len || memcmp(ent.word, str, len) != 0)
+        return nullptr;
+    return &ent;
+}
@@ -0,0 +1,191 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "LZCodec.h"
+#include <string.h>
+
+const size_t MinMatch     = 4;
+const size_t MaxOffset    = 0xFFFF;
+const size_t HashBits     = 16;
+const size_t LastLiterals = 5;   // the input always ends with literals
+const size_t MatchLimit   = 12;  // no match starts in the last 12 bytes
+
+inline uint32_t read32(const uint8_t* ptr)
+{
+    uint32_t v;
+    memcpy(&v, ptr, sizeof(uint32_t));
+    return v;
+}
+
+inline size_t hashSequence(uint32_t v)
+{
+    return (size_t)((v * 2654435761u) >> (32 - HashBits));
+}
+
+inline void writeLength(LZBuffer& dest, size_t len)
+{
+    while (len >= 255)
+    {
+        dest.push_back(255);
+        len -= 255;
+    }
+    dest.push_back((uint8_t)len);
+}
+
+inline bool readLength(const uint8_t* src, size_t srcLen, size_t& ip, size_t& len)
+{
+    uint8_t v;
+    do
+    {
+        if (ip >= srcLen)
+            return false;
+        v = src[ip++];
+        len += v;
+    } while (v == 255);
+    return true;
+}
+
+inline void writeSequence(LZBuffer&      dest,
+                          const uint8_t* lit,
+                          size_t         litLen,
+                          size_t         offset,
+                          size_t         matchLen)
+{
+    uint8_t token = (uint8_t)((litLen < 15 ? litLen : 15) << 4);
+    if (matchLen != 0)
+    {
+        size_t ml = matchLen - MinMatch;
+        token |= (uint8_t)(ml < 15 ? ml : 15);
+    }
+
+    dest.push_back(token);
+    if (litLen >= 15)
+        writeLength(dest, litLen - 15);
+    dest.insert(dest.end(), lit, lit + litLen);
+
+    if (matchLen != 0)
+    {
+        dest.push_back((uint8_t)(offset & 0xFF));
+        dest.push_back((uint8_t)(offset >> 8));
+        if (matchLen - MinMatch >= 15)
+            writeLength(dest, matchLen - MinMatch - 15);
+    }
+}
+
+void LZCodec::compress(const uint8_t* src, size_t len, LZBuffer& dest)
+{
+    dest.reserve(dest.size() + len / 2 + 16);
+
+    size_t anchor = 0, i = 0;
+    if (len > MatchLimit)
+    {
+        // Positions are stored plus one, so zero is empty.
+        std::vector<uint64_t> table((size_t)1 << HashBits, 0);
+
+        size_t limit = len - MatchLimit;
+        size_t end   = len - LastLiterals;
+        while (i < limit)
+        {
+            uint32_t seq = read32(src + i);
+            size_t   h   = hashSequence(seq);
+            size_t   ref = (size_t)table[h];
+            table[h]     = i + 1;
+
+            if (ref == 0 || i - (ref - 1) > MaxOffset || read32(src + ref - 1) != seq)
+            {
+                ++i;
+                continue;
+            }
+
+            --ref;
+            size_t match = MinMatch;
+            while (i + match < end && src[ref + match] == src[i + match])
+                ++match;
+
+            writeSequence(dest, src + anchor, i - anchor, i - ref, match);
+            i += match;
+            anchor = i;
+        }
+    }
+
+    writeSequence(dest, src + anchor, len - anchor, 0, 0);
+}
+
+int LZCodec::decompress(const uint8_t* src,
+                        size_t         srcLen,
+                        uint8_t*       dest,
+                        size_t         destLen)
+{
+    size_t ip = 0, op = 0;
+    while (ip < srcLen)
+    {
+        uint8_t token = src[ip++];
+
+        size_t lit = token >> 4;
+        if (lit == 15 && !readLength(src, srcLen, ip, lit))
+            return PS_ERROR;
+        if (lit > srcLen - ip || lit > destLen - op)
+            return PS_ERROR;
+
+        memcpy(dest + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+
+        // the last sequence only has literals
+        if (ip == srcLen)
+            break;
+
+        if (srcLen - ip < 2)
+            return PS_ERROR;
+
+        size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return PS_ERROR;
+
+        size_t match = token & 15;
+        if (match == 15 && !readLength(src, srcLen, ip, match))
+            return PS_ERROR;
+
+        match += MinMatch;
+        if (match > destLen - op)
+            return PS_ERROR;
+
+        // A match may overlap what it is copying. The bytes from
+        // ref repeat every offset bytes, so each copy can be as
+        // long as everything written since ref, which doubles.
+        const uint8_t* ref  = dest + op - offset;
+        uint8_t*       out  = dest + op;
+        size_t         left = match;
+        while (left > 0)
+        {
+            size_t nr = (size_t)(out - ref);
+            if (nr > left)
+                nr = left;
+
+            memcpy(out, ref, nr);
+            out += nr;
+            left -= nr;
+        }
+        op += match;
+    }
+    return op == destLen ? PS_OK : PS_ERROR;
+}
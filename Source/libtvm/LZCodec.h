@@ -0,0 +1,49 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _LZCodec_h_
+#define _LZCodec_h_
+
+#include <stdint.h>
+#include <vector>
+#include "Declarations.h"
+
+using LZBuffer = std::vector<uint8_t>;
+
+// A small LZ77 codec, using the LZ4 block layout. Each sequence is
+// a token, the literals, a 16-bit offset and the match length. It
+// favors decoding speed, so sections can be expanded straight into
+// their runtime buffers while an image is loaded.
+class LZCodec
+{
+public:
+    // Appends the compressed form of src to dest.
+    static void compress(const uint8_t* src, size_t len, LZBuffer& dest);
+
+    // Expands src into dest. It returns PS_ERROR unless the
+    // input is well formed and fills exactly destLen bytes.
+    static int decompress(const uint8_t* src,
+                          size_t         srcLen,
+                          uint8_t*       dest,
+                          size_t         destLen);
+};
+
+#endif  //_LZCodec_h_
@@ -0,0 +1,238 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "LoadProfile.h"
+#include <stdio.h>
+#include <atomic>
+
+using namespace std;
+
+const char* PhaseNames[LP_MAX] = {
+    "read",
+    "data",
+    "symbol",
+    "library",
+    "function",
+    "cache",
+    "code",
+    "string",
+    "resolve",
+    "verify",
+};
+
+atomic<uint64_t> Allocations(0);
+atomic<uint64_t> AllocatedBytes(0);
+
+// The number of enabled profiles. Allocations are
+// only counted while there is at least one.
+atomic<uint32_t> Profiles(0);
+
+inline void printJsonString(const char* str)
+{
+    putchar('"');
+    for (; str && *str; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+            printf("\\%c", *str);
+        else if ((unsigned char)*str < 32)
+            printf("\\u%04x", (unsigned char)*str);
+        else
+            putchar(*str);
+    }
+    putchar('"');
+}
+
+inline void printJsonTime(const LoadPhaseTime& time)
+{
+    printf("\"seconds\": %.9f, \"allocations\": %llu, \"bytes\": %llu",
+           time.seconds,
+           (unsigned long long)time.allocations,
+           (unsigned long long)time.bytes);
+}
+
+inline void printTextTime(const char* name, const LoadPhaseTime& time)
+{
+    printf("    %-12s %12.6f %12llu %14llu\n",
+           name,
+           time.seconds,
+           (unsigned long long)time.allocations,
+           (unsigned long long)time.bytes);
+}
+
+LoadProfile::LoadProfile() :
+    m_enabled(false),
+    m_phases(),
+    m_details(),
+    m_active(nullptr)
+{
+}
+
+LoadProfile::~LoadProfile()
+{
+    setEnabled(false);
+}
+
+void LoadProfile::setEnabled(bool enabled)
+{
+    if (enabled && !m_enabled)
+        Profiles.fetch_add(1, memory_order_relaxed);
+    else if (!enabled && m_enabled)
+        Profiles.fetch_sub(1, memory_order_relaxed);
+    m_enabled = enabled;
+}
+
+LoadPhaseTime LoadProfile::total(void) const
+{
+    LoadPhaseTime sum = {};
+
+    int i;
+    for (i = 0; i < LP_MAX; ++i)
+    {
+        sum.seconds += m_phases[i].seconds;
+        sum.allocations += m_phases[i].allocations;
+        sum.bytes += m_phases[i].bytes;
+    }
+    return sum;
+}
+
+void LoadProfile::print(const char* fname) const
+{
+    printf("load '%s'\n", fname ? fname : "");
+    printf("    %-12s %12s %12s %14s\n", "phase", "seconds", "allocations", "bytes");
+
+    int i;
+    for (i = 0; i < LP_MAX; ++i)
+    {
+        printTextTime(PhaseNames[i], m_phases[i]);
+
+        LoadDetails::const_iterator it = m_details.begin();
+        for (; it != m_details.end(); ++it)
+        {
+            if (it->phase == i)
+            {
+                str_t name = "  " + it->name;
+                printTextTime(name.c_str(), it->time);
+            }
+        }
+    }
+    printTextTime("total", total());
+}
+
+void LoadProfile::printJson(const char* fname) const
+{
+    printf("{\"file\": ");
+    printJsonString(fname);
+    printf(", \"phases\": [");
+
+    int i;
+    for (i = 0; i < LP_MAX; ++i)
+    {
+        printf(i > 0 ? ", {\"name\": " : "{\"name\": ");
+        printJsonString(PhaseNames[i]);
+        printf(", ");
+        printJsonTime(m_phases[i]);
+        printf("}");
+    }
+    printf("], \"details\": [");
+
+    LoadDetails::const_iterator it = m_details.begin();
+    for (; it != m_details.end(); ++it)
+    {
+        printf(it != m_details.begin() ? ", {\"phase\": " : "{\"phase\": ");
+        printJsonString(PhaseNames[it->phase]);
+        printf(", \"name\": ");
+        printJsonString(it->name.c_str());
+        printf(", ");
+        printJsonTime(it->time);
+        printf("}");
+    }
+    printf("], \"total\": {");
+    printJsonTime(total());
+    printf("}}\n");
+}
+
+const char* LoadProfile::getPhaseName(LoadPhase phase)
+{
+    if (phase < LP_MAX)
+        return PhaseNames[phase];
+    return "";
+}
+
+void LoadProfile::countAllocation(size_t bytes)
+{
+    // Every operator new comes through here, so nothing
+    // is written unless a profile is collecting them.
+    if (Profiles.load(memory_order_relaxed) == 0)
+        return;
+
+    Allocations.fetch_add(1, memory_order_relaxed);
+    AllocatedBytes.fetch_add(bytes, memory_order_relaxed);
+}
+
+LoadTimer::LoadTimer(LoadProfile& profile, LoadPhase phase, const char* name) :
+    m_profile(nullptr),
+    m_parent(nullptr),
+    m_phase(phase),
+    m_name(name),
+    m_begin(),
+    m_start(),
+    m_nested()
+{
+    if (!profile.enabled())
+        return;
+
+    m_profile = &profile;
+    m_parent  = profile.m_active;
+
+    profile.m_active    = this;
+    m_start.allocations = Allocations.load(memory_order_relaxed);
+    m_start.bytes       = AllocatedBytes.load(memory_order_relaxed);
+    m_begin             = Clock::now();
+}
+
+LoadTimer::~LoadTimer()
+{
+    if (!m_profile)
+        return;
+
+    LoadPhaseTime time;
+    time.seconds     = chrono::duration<double>(Clock::now() - m_begin).count();
+    time.allocations = Allocations.load(memory_order_relaxed) - m_start.allocations;
+    time.bytes       = AllocatedBytes.load(memory_order_relaxed) - m_start.bytes;
+
+    // Only the time that was not spent in a nested
+    // phase belongs to this one.
+    LoadPhaseTime& dest = m_profile->m_phases[m_phase];
+    dest.seconds += time.seconds - m_nested.seconds;
+    dest.allocations += time.allocations - m_nested.allocations;
+    dest.bytes += time.bytes - m_nested.bytes;
+
+    if (m_name)
+        m_profile->m_details.push_back({m_phase, m_name, time});
+
+    if (m_parent)
+    {
+        m_parent->m_nested.seconds += time.seconds;
+        m_parent->m_nested.allocations += time.allocations;
+        m_parent->m_nested.bytes += time.bytes;
+    }
+    m_profile->m_active = m_parent;
+}
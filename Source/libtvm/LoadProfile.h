@@ -0,0 +1,135 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _LoadProfile_h_
+#define _LoadProfile_h_
+
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+#include "Declarations.h"
+
+enum LoadPhase
+{
+    LP_READ = 0,  // opening the file and reading the header
+    LP_DATA,      // data, BSS and read-only data sections
+    LP_SYMBOL,    // symbol or import section
+    LP_LIBRARY,   // loading each shared library
+    LP_FUNCTION,  // function index section
+    LP_CACHE,     // hashing the image and searching the cache
+    LP_CODE,      // reading or decoding the instructions
+    LP_STRING,    // string section
+    LP_RESOLVE,   // binding native calls with findDynamic
+    LP_VERIFY,    // checkInstruction and the read-only checks
+    LP_MAX,
+};
+
+struct LoadPhaseTime
+{
+    double   seconds;
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+struct LoadDetail
+{
+    LoadPhase     phase;
+    str_t         name;
+    LoadPhaseTime time;
+};
+
+using LoadDetails = std::vector<LoadDetail>;
+
+class LoadTimer;
+
+// Collects the wall time and the number of allocations spent in
+// each phase of Program::load. Phases are exclusive, so a phase
+// that runs inside of another one is not counted twice.
+//
+// Allocations are only counted when the executable reports them
+// through countAllocation, from its replacement operator new, and
+// only while a profile is enabled.
+class LoadProfile
+{
+private:
+    friend class LoadTimer;
+
+    bool          m_enabled;
+    LoadPhaseTime m_phases[LP_MAX];
+    LoadDetails   m_details;
+    LoadTimer*    m_active;
+
+public:
+    LoadProfile();
+    ~LoadProfile();
+
+    LoadProfile(const LoadProfile&)            = delete;
+    LoadProfile& operator=(const LoadProfile&) = delete;
+
+    void setEnabled(bool enabled);
+
+    bool enabled(void) const
+    {
+        return m_enabled;
+    }
+
+    const LoadPhaseTime& getPhase(LoadPhase phase) const
+    {
+        return m_phases[phase];
+    }
+
+    const LoadDetails& getDetails(void) const
+    {
+        return m_details;
+    }
+
+    LoadPhaseTime total(void) const;
+
+    void print(const char* fname) const;
+    void printJson(const char* fname) const;
+
+    static const char* getPhaseName(LoadPhase phase);
+
+    static void countAllocation(size_t bytes);
+};
+
+// Adds the time from construction to destruction to a phase of
+// the profile. When a name is given, the time is also recorded
+// as a detail of the phase. Does nothing if the profile is off.
+class LoadTimer
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    LoadProfile*      m_profile;
+    LoadTimer*        m_parent;
+    LoadPhase         m_phase;
+    const char*       m_name;
+    Clock::time_point m_begin;
+    LoadPhaseTime     m_start;
+    LoadPhaseTime     m_nested;
+
+public:
+    LoadTimer(LoadProfile& profile, LoadPhase phase, const char* name = nullptr);
+    ~LoadTimer();
+};
+
+#endif  //_LoadProfile_h_
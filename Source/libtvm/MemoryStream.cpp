@@ -22,11 +22,14 @@
 #include "MemoryStream.h"
 #include <memory.h>
 #include <string.h>
+#include "PageMemory.h"
 
 MemoryStream::MemoryStream() :
-    m_data(nullptr),
     m_size(0),
-    m_capacity(0)
+    m_capacity(0),
+    m_data(nullptr),
+    m_mapped(false),
+    m_mode(PM_DEFAULT)
 {
 }
 
@@ -37,13 +40,41 @@ MemoryStream::~MemoryStream()
 
 void MemoryStream::clear(void)
 {
-    if (m_data)
+    if (m_data && m_mapped)
+    {
+        UnmapPages(m_data, m_capacity + 1, m_mode);
+        m_data = nullptr;
+    }
+    else if (m_data)
     {
         delete[] m_data;
         m_data = nullptr;
     }
     m_size     = 0;
     m_capacity = 0;
+    m_mapped   = false;
+    m_mode     = PM_DEFAULT;
+}
+
+void MemoryStream::map(size_t nr, int mode)
+{
+    clear();
+    if (nr == 0)
+        return;
+
+    void* buf = MapPages(nr + 1, mode);
+    if (buf == nullptr)
+    {
+        // fall back to the heap
+        reserve(nr);
+        memset(m_data, 0, nr + 1);
+        return;
+    }
+
+    m_data     = (uint8_t*)buf;
+    m_capacity = nr;
+    m_mapped   = true;
+    m_mode     = mode;
 }
 
 void MemoryStream::reserve(size_t nr)
@@ -53,8 +84,10 @@ void MemoryStream::reserve(size_t nr)
         uint8_t* buf = new uint8_t[nr + 1];
         if (m_data != 0)
         {
+            size_t size = m_size;
             memcpy(buf, m_data, m_size);
-            delete[] m_data;
+            clear();
+            m_size = size;
         }
         m_data     = buf;
         m_capacity = nr;
@@ -126,6 +159,11 @@ size_t MemoryStream::writeString(const char* src, size_t len)
     return write(src, len, true);
 }
 
+size_t MemoryStream::writeBlock(const void* src, size_t len)
+{
+    return write(src, len, false);
+}
+
 size_t MemoryStream::write8(uint8_t val)
 {
     return write(&val, 1, false);
@@ -23,6 +23,7 @@
 #define _MemoryStream_h_
 
 #include "Declarations.h"
+#include "PageMemory.h"
 
 class MemoryStream
 {
@@ -32,6 +33,7 @@ public:
 
     void   clear(void);
     size_t writeString(const char* src, size_t len);
+    size_t writeBlock(const void* src, size_t len);
     size_t write8(uint8_t val);
     size_t write16(uint16_t val);
     size_t write32(uint32_t val);
@@ -39,6 +41,10 @@ public:
     size_t fill(size_t nr, uint8_t code);
 
     void reserve(size_t cap);
+
+    // Reserves cap bytes of zeroed memory. Pages are only
+    // committed by the system when they are first touched.
+    void map(size_t cap, int mode = PM_DEFAULT);
     void cloneInto(MemoryStream& dest);
 
     size_t addr(size_t idx);
@@ -71,6 +77,8 @@ private:
     size_t m_capacity;
 
     uint8_t* m_data;
+    bool     m_mapped;
+    int      m_mode;
 };
 
 #endif  //_MemoryStream_h_
@@ -0,0 +1,299 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "ObjectFile.h"
+#include <stdio.h>
+#include <string.h>
+#include "BlockReader.h"
+
+using Bytes = std::vector<uint8_t>;
+
+inline size_t getPadding(size_t size)
+{
+    return (8 - size % 8) % 8;
+}
+
+inline void append(Bytes& dest, const void* src, size_t len)
+{
+    const uint8_t* bytes = (const uint8_t*)src;
+    dest.insert(dest.end(), bytes, bytes + len);
+    dest.insert(dest.end(), getPadding(len), 0);
+}
+
+// Hands out the sections of a loaded object in order,
+// and fails if one runs past the end of the file.
+class ObjectCursor
+{
+private:
+    const uint8_t* m_ptr;
+    size_t         m_len;
+
+public:
+    ObjectCursor(const uint8_t* ptr, size_t len) :
+        m_ptr(ptr),
+        m_len(len)
+    {
+    }
+
+    const uint8_t* take(size_t len)
+    {
+        size_t padded = len + getPadding(len);
+        if (len > m_len || padded > m_len)
+            return nullptr;
+
+        const uint8_t* ptr = m_ptr;
+        m_ptr += padded;
+        m_len -= padded;
+        return ptr;
+    }
+
+    template <typename T>
+    bool read(T& dest)
+    {
+        const uint8_t* ptr = take(sizeof(T));
+        if (ptr)
+            memcpy(&dest, ptr, sizeof(T));
+        return ptr != nullptr;
+    }
+};
+
+bool ObjectFile::isObject(const char* fname)
+{
+    size_t len = fname ? strlen(fname) : 0;
+    return len > 4 && strcmp(fname + len - 4, ".tvo") == 0;
+}
+
+int ObjectFile::save(const CompileUnit& unit, const char* fname)
+{
+    ObjectHeader header = {};
+    header.code[0]      = 'T';
+    header.code[1]      = 'O';
+    header.version      = OBJ_VERSION;
+    header.labels       = unit.labels;
+    header.names        = unit.names.byteSize();
+    header.instructions = unit.ins.size();
+    header.data         = unit.data.size();
+
+    Bytes out;
+    out.reserve(sizeof(ObjectHeader) +
+                header.names + 8 +
+                unit.names.size() * sizeof(ObjectName) +
+                unit.ins.size() * sizeof(ObjectIns));
+
+    append(out, &header, sizeof(ObjectHeader));
+
+    // the names are in the same layout as a string section
+    uint32_t count = (uint32_t)unit.names.size();
+    out.insert(out.end(), (const uint8_t*)&count, (const uint8_t*)(&count + 1));
+    out.insert(out.end(),
+               (const uint8_t*)unit.names.offsets(),
+               (const uint8_t*)(unit.names.offsets() + count));
+    out.insert(out.end(), unit.names.data(), unit.names.data() + unit.names.dataSize());
+    out.insert(out.end(), getPadding(header.names), 0);
+
+    size_t i;
+    for (i = 0; i < count; ++i)
+    {
+        ObjectName name = {};
+        if (i < unit.info.size())
+        {
+            name.label = unit.info[i].label;
+            name.data  = unit.info[i].data;
+        }
+        append(out, &name, sizeof(ObjectName));
+    }
+
+    Instructions::const_iterator it = unit.ins.begin();
+    for (; it != unit.ins.end(); ++it)
+    {
+        ObjectIns ins = {};
+        ins.op        = it->op;
+        ins.argc      = it->argc;
+        ins.flags     = it->flags;
+        ins.index     = it->index;
+        ins.name      = it->name;
+        ins.label     = it->label;
+        memcpy(ins.argv, it->argv, sizeof(ins.argv));
+        append(out, &ins, sizeof(ObjectIns));
+    }
+
+    DataDeclarations::const_iterator dt = unit.data.begin();
+    for (; dt != unit.data.end(); ++dt)
+    {
+        ObjectData data = {};
+        data.name       = dt->name;
+        data.type       = dt->type;
+        data.readonly   = dt->readonly ? 1 : 0;
+        data.ival       = dt->ival;
+        data.length     = dt->sval.size();
+        data.values     = dt->values.size();
+
+        append(out, &data, sizeof(ObjectData));
+        append(out, dt->sval.data(), dt->sval.size());
+        append(out, dt->values.data(), dt->values.size() * sizeof(uint64_t));
+    }
+
+    FILE* fp = fopen(fname, "wb");
+    if (!fp)
+    {
+        printf("failed to open '%s' for writing.\n", fname);
+        return PS_ERROR;
+    }
+
+    bool ok = fwrite(out.data(), 1, out.size(), fp) == out.size();
+    ok      = fclose(fp) == 0 && ok;
+    if (!ok)
+    {
+        printf("failed to write '%s'.\n", fname);
+        return PS_ERROR;
+    }
+    return PS_OK;
+}
+
+int ObjectFile::load(CompileUnit& unit, const char* fname)
+{
+    unit = CompileUnit();
+
+    BlockReader reader(fname);
+    if (!reader.ptr())
+        return PS_ERROR;
+
+    ObjectCursor cur(reader.ptr(), reader.size());
+    ObjectHeader header = {};
+
+    if (!cur.read(header) ||
+        header.code[0] != 'T' ||
+        header.code[1] != 'O' ||
+        header.version != OBJ_VERSION)
+    {
+        printf("'%s' is not an object file.\n", fname);
+        return PS_ERROR;
+    }
+
+    // The sizes are checked against the file before
+    // anything is allocated for them.
+    const uint8_t* block = cur.take((size_t)header.names);
+
+    StringTable names;
+    if (!block || names.load(block, (size_t)header.names) != PS_OK ||
+        names.empty() || !names.get(0).empty())
+    {
+        printf("invalid name table in '%s'.\n", fname);
+        return PS_ERROR;
+    }
+
+    size_t count = names.size();
+    if (header.instructions > reader.size() / sizeof(ObjectIns) ||
+        header.data > reader.size() / sizeof(ObjectData) ||
+        count > reader.size() / sizeof(ObjectName))
+    {
+        printf("invalid object '%s'.\n", fname);
+        return PS_ERROR;
+    }
+
+    int    status = PS_OK;
+    size_t i;
+
+    unit.info.resize(count);
+    for (i = 0; i < count && status == PS_OK; ++i)
+    {
+        ObjectName name = {};
+        if (!cur.read(name) ||
+            name.label > header.labels ||
+            name.data > header.data ||
+            unit.names.intern(names.get(i)) != i)
+            status = PS_ERROR;
+
+        unit.info[i].label = name.label;
+        unit.info[i].data  = name.data;
+    }
+
+    unit.ins.resize(status == PS_OK ? (size_t)header.instructions : 0);
+
+    Instructions::iterator it = unit.ins.begin();
+    for (; it != unit.ins.end() && status == PS_OK; ++it)
+    {
+        ObjectIns ins = {};
+        if (!cur.read(ins) ||
+            ins.argc > INS_ARG ||
+            ins.name >= count ||
+            ins.label > header.labels)
+            status = PS_ERROR;
+
+        it->op    = ins.op;
+        it->argc  = ins.argc;
+        it->flags = ins.flags;
+        it->index = ins.index;
+        it->name  = ins.name;
+        it->label = ins.label;
+        memcpy(it->argv, ins.argv, sizeof(ins.argv));
+    }
+
+    unit.data.resize(status == PS_OK ? (size_t)header.data : 0);
+
+    DataDeclarations::iterator dt = unit.data.begin();
+    for (; dt != unit.data.end() && status == PS_OK; ++dt)
+    {
+        ObjectData data = {};
+        if (!cur.read(data) || data.name >= count)
+        {
+            status = PS_ERROR;
+            break;
+        }
+
+        const uint8_t* sval = cur.take((size_t)data.length);
+        if (!sval || data.values > reader.size() / sizeof(uint64_t))
+        {
+            status = PS_ERROR;
+            break;
+        }
+
+        const uint8_t* values = cur.take((size_t)data.values * sizeof(uint64_t));
+        if (!values)
+        {
+            status = PS_ERROR;
+            break;
+        }
+
+        dt->name     = data.name;
+        dt->type     = data.type;
+        dt->readonly = data.readonly != 0;
+        dt->ival     = data.ival;
+        dt->sval     = unit.strings.store(std::string_view((const char*)sval, (size_t)data.length));
+        dt->values.resize((size_t)data.values);
+        if (data.values > 0)
+            memcpy(dt->values.data(), values, (size_t)data.values * sizeof(uint64_t));
+    }
+
+    if (status != PS_OK)
+    {
+        printf("invalid object '%s'.\n", fname);
+        unit = CompileUnit();
+        return PS_ERROR;
+    }
+
+    unit.labels = header.labels;
+    return PS_OK;
+}
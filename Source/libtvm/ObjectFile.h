@@ -0,0 +1,98 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _ObjectFile_h_
+#define _ObjectFile_h_
+
+#include <stdint.h>
+#include "CompileUnit.h"
+
+#define OBJ_VERSION 1
+
+// A compile unit that has been parsed but not linked. It holds
+// everything mergeUnit needs, so objects and source files can be
+// given to tcom in any mix. Every section is padded to 8 bytes.
+//
+//      ObjectHeader
+//      names            a StringTable section
+//      ObjectName       one per name, label and data index
+//      ObjectIns        one per instruction
+//      ObjectData       one per declaration, each followed by
+//                       its string bytes and then its values
+//
+// A name that is neither a label nor data is a reference that
+// is resolved when the objects are linked.
+struct ObjectHeader
+{
+    uint8_t  code[2];
+    uint16_t version;
+    uint32_t reserved;
+    uint64_t labels;        // the number of labels in the unit
+    uint64_t names;         // byte size of the names section
+    uint64_t instructions;  // the number of instructions
+    uint64_t data;          // the number of declarations
+};
+
+struct ObjectName
+{
+    uint64_t label;
+    uint32_t data;
+    uint32_t reserved;
+};
+
+struct ObjectIns
+{
+    uint8_t  op;
+    uint8_t  argc;
+    uint16_t flags;
+    uint8_t  index;
+    uint8_t  reserved[3];
+    uint32_t name;
+    uint32_t pad;
+    uint64_t label;
+    uint64_t argv[INS_ARG];
+};
+
+struct ObjectData
+{
+    uint32_t name;
+    uint16_t type;
+    uint8_t  readonly;
+    uint8_t  reserved;
+    uint64_t ival;
+    uint64_t length;  // bytes in sval
+    uint64_t values;  // the number of values
+};
+
+class ObjectFile
+{
+public:
+    // Returns true if fname has the .tvo extension.
+    static bool isObject(const char* fname);
+
+    static int save(const CompileUnit& unit, const char* fname);
+
+    // Replaces unit with the contents of fname. Anything that
+    // does not fit the layout above is reported as PS_ERROR.
+    static int load(CompileUnit& unit, const char* fname);
+};
+
+#endif  //_ObjectFile_h_
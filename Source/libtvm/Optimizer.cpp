@@ -0,0 +1,447 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Optimizer.h"
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+Optimizer::Optimizer(Instructions& ins, const NameInfos& names) :
+    m_ins(ins),
+    m_names(names)
+{
+}
+
+Optimizer::~Optimizer()
+{
+}
+
+bool Optimizer::isLocalLabel(uint32_t name)
+{
+    // Anything that is not a label in the text section is either
+    // a data declaration or a symbol found in a shared library.
+    return name != 0 && name < m_names.size() && m_names[name].label != 0;
+}
+
+void Optimizer::findLabelStarts(LabelStarts& first)
+{
+    size_t   i, n = m_ins.size();
+    uint64_t labels = 0;
+    for (i = 0; i < n; ++i)
+        labels = std::max(labels, m_ins[i].label);
+
+    first.assign(labels + 1, NO_INDEX);
+    for (i = 0; i < n; ++i)
+    {
+        if (isLabelStart(i))
+            first[m_ins[i].label] = i;
+    }
+
+    uint64_t next = NO_INDEX;
+    for (i = first.size(); i-- > 0;)
+    {
+        if (first[i] == NO_INDEX)
+            first[i] = next;
+        else
+            next = first[i];
+    }
+}
+
+uint64_t Optimizer::findStart(const LabelStarts& first, uint32_t name)
+{
+    uint64_t label = m_names[name].label;
+    if (label < first.size())
+        return first[label];
+    return NO_INDEX;
+}
+
+uint32_t Optimizer::findChainEnd(const LabelStarts& first, ChainEnds& ends, uint32_t name)
+{
+    const uint32_t unset = UINT32_MAX, busy = UINT32_MAX - 1;
+    if (ends.size() != first.size())
+        ends.assign(first.size(), unset);
+
+    // Walk until the chain ends, joins one that is already
+    // known, or comes back to a label on this walk.
+    std::vector<uint64_t> path;
+
+    uint32_t cur = name, end = 0;
+    bool     loop = false;
+    for (;;)
+    {
+        uint64_t label = m_names[cur].label;
+        if (label < ends.size() && ends[label] != unset)
+        {
+            loop = ends[label] == busy;
+            end  = ends[label] != 0 ? ends[label] : cur;
+            break;
+        }
+
+        uint64_t start = findStart(first, cur);
+        if (start == NO_INDEX ||
+            m_ins[start].op != OP_JMP ||
+            !isLocalLabel(m_ins[start].name))
+        {
+            if (label < ends.size())
+                ends[label] = 0;
+            end = cur;
+            break;
+        }
+
+        ends[label] = busy;
+        path.push_back(label);
+        cur = m_ins[start].name;
+    }
+
+    // Anything that loops back on itself is left alone.
+    std::vector<uint64_t>::iterator it = path.begin();
+    for (; it != path.end(); ++it)
+        ends[*it] = loop ? 0 : end;
+
+    uint64_t label = m_names[name].label;
+    return label < ends.size() ? ends[label] : 0;
+}
+
+bool Optimizer::isLabelStart(size_t idx)
+{
+    // The label index only changes on the first
+    // instruction that follows a new label.
+    if (idx == 0 || idx >= m_ins.size())
+        return true;
+    return m_ins[idx].label != m_ins[idx - 1].label;
+}
+
+size_t Optimizer::tailCalls(void)
+{
+    size_t i, n = m_ins.size(), total = 0;
+
+    for (i = 0; i + 1 < n; ++i)
+    {
+        Instruction& ins = m_ins[i];
+        if (ins.op != OP_GTO || !isLocalLabel(ins.name))
+            continue;
+
+        const Instruction& next = m_ins[i + 1];
+        if (next.op == OP_RET)
+        {
+            // The ret is left in place, it may still
+            // be reached from somewhere else.
+            ins.op = OP_JMP;
+            ++total;
+        }
+        else if (next.op == OP_LDP &&
+                 next.flags & IF_STKP &&
+                 i + 2 < n &&
+                 m_ins[i + 2].op == OP_RET &&
+                 !isLabelStart(i + 1))
+        {
+            // Tear down the frame before the jump so the
+            // stack stays the same size across iterations.
+            // Both are under the same label, so swapping
+            // them does not move a branch target.
+            ins.op = OP_JMP;
+            std::swap(m_ins[i], m_ins[i + 1]);
+            ++total;
+            ++i;
+        }
+    }
+    return total;
+}
+
+size_t Optimizer::unreferencedFunctions(uint32_t entry)
+{
+    using Indices = std::vector<uint64_t>;
+
+    size_t i, n = m_ins.size();
+    if (n == 0 || !isLocalLabel(entry))
+        return 0;
+
+    LabelStarts first;
+    findLabelStarts(first);
+
+    Indices starts(1, 0);
+    std::vector<uint8_t> isStart(n, 0);
+    isStart[0] = 1;
+
+    uint64_t target = findStart(first, entry);
+    if (target == NO_INDEX)
+        return 0;
+    isStart[target] = 1;
+
+    for (i = 0; i < n; ++i)
+    {
+        // A jump through a register can land anywhere,
+        // so nothing can be shown to be unreachable.
+        const Instruction& ins = m_ins[i];
+        if (ins.op == OP_MOV && ins.flags & IF_INSP)
+            return 0;
+
+        if (ins.op == OP_GTO && isLocalLabel(ins.name))
+        {
+            target = findStart(first, ins.name);
+            if (target != NO_INDEX)
+                isStart[target] = 1;
+        }
+    }
+
+    // Number the functions, then walk out from the entry.
+    std::vector<uint32_t> func(n);
+    for (i = 1; i < n; ++i)
+    {
+        if (isStart[i])
+            starts.push_back(i);
+        func[i] = (uint32_t)starts.size() - 1;
+    }
+    starts.push_back(n);
+
+    std::vector<uint8_t>  live(starts.size() - 1, 0);
+    std::vector<uint32_t> stack;
+
+    uint32_t fn = func[findStart(first, entry)];
+    live[fn]    = 1;
+    stack.push_back(fn);
+
+    while (!stack.empty())
+    {
+        fn = stack.back();
+        stack.pop_back();
+
+        uint64_t end = starts[fn + 1];
+        for (i = starts[fn]; i < end; ++i)
+        {
+            const Instruction& ins = m_ins[i];
+            if (!isLocalLabel(ins.name))
+                continue;
+
+            target = findStart(first, ins.name);
+            if (target != NO_INDEX && !live[func[target]])
+            {
+                live[func[target]] = 1;
+                stack.push_back(func[target]);
+            }
+        }
+
+        uint8_t last = m_ins[end - 1].op;
+        if (last != OP_RET && last != OP_JMP && fn + 1 < live.size() && !live[fn + 1])
+        {
+            live[fn + 1] = 1;
+            stack.push_back(fn + 1);
+        }
+    }
+
+    size_t kept = 0;
+    for (i = 0; i < n; ++i)
+    {
+        if (live[func[i]])
+            m_ins[kept++] = m_ins[i];
+    }
+    m_ins.resize(kept);
+    return n - kept;
+}
+
+bool Optimizer::isSelfMove(const Instruction& ins)
+{
+    // A width flag truncates the register, so only
+    // the full 64 bit copy has no effect.
+    return ins.op == OP_MOV &&
+           ins.argc == 2 &&
+           ins.name == 0 &&
+           ins.flags == (IF_REG0 | IF_REG1) &&
+           ins.argv[0] == ins.argv[1];
+}
+
+bool Optimizer::isIdentity(const Instruction& ins)
+{
+    uint64_t value;
+    switch (ins.op)
+    {
+    case OP_ADD:
+    case OP_SUB:
+    case OP_SHR:
+    case OP_SHL:
+        value = 0;
+        break;
+    case OP_MUL:
+    case OP_DIV:
+        value = 1;
+        break;
+    default:
+        return false;
+    }
+
+    if (ins.name != 0)
+        return false;
+    if (ins.argc == 2)
+        return ins.flags == IF_REG0 && ins.argv[1] == value;
+    if (ins.argc == 3)
+    {
+        return (ins.flags & ~IF_REG1) == IF_REG0 &&
+               ins.argv[2] == value;
+    }
+    return false;
+}
+
+bool Optimizer::isSameCompare(size_t idx)
+{
+    // Look back over the conditional branches in front of idx. A
+    // branch that falls through leaves the flags as they were,
+    // so the first cmp found has already set them.
+    const Instruction& cmp = m_ins[idx];
+    if (cmp.op != OP_CMP || isLabelStart(idx))
+        return false;
+
+    size_t i = idx;
+    while (i-- > 0)
+    {
+        const Instruction& ins = m_ins[i];
+        if (ins.op == OP_CMP)
+        {
+            return ins.argc == cmp.argc &&
+                   ins.flags == cmp.flags &&
+                   ins.name == cmp.name &&
+                   ins.argv[0] == cmp.argv[0] &&
+                   ins.argv[1] == cmp.argv[1];
+        }
+        if (ins.op < OP_JEQ || ins.op > OP_JGE || isLabelStart(i))
+            return false;
+    }
+    return false;
+}
+
+size_t Optimizer::peepholePass(int rules, PeepholeCounts& counts)
+{
+    size_t i, n = m_ins.size(), total = 0;
+
+    LabelStarts first;
+    findLabelStarts(first);
+
+    ChainEnds ends;
+
+    // The last instruction is kept so that every label
+    // still has an instruction at or after it.
+    std::vector<uint8_t> dead(n, 0);
+    for (i = 0; i + 1 < n; ++i)
+    {
+        Instruction& ins = m_ins[i];
+        int          rule = PR_MAX;
+
+        if (rules & PR_BIT(PR_MOVE) && isSelfMove(ins))
+        {
+            dead[i] = 1;
+            rule    = PR_MOVE;
+        }
+        else if (rules & PR_BIT(PR_IDENTITY) && isIdentity(ins))
+        {
+            if (ins.argc == 2 || (ins.flags & IF_REG1 && ins.argv[1] == ins.argv[0]))
+                dead[i] = 1;
+            else
+            {
+                // x0 = b op identity is a move of b.
+                ins.op      = OP_MOV;
+                ins.argc    = 2;
+                ins.argv[2] = 0;
+            }
+            rule = PR_IDENTITY;
+        }
+        else if (rules & PR_BIT(PR_NEXT) &&
+                 ins.op == OP_JMP &&
+                 isLocalLabel(ins.name) &&
+                 findStart(first, ins.name) == i + 1)
+        {
+            // Conditional branches stay, since a taken
+            // one also clears the flag it tested.
+            dead[i] = 1;
+            rule    = PR_NEXT;
+        }
+        else if (rules & PR_BIT(PR_CHAIN) &&
+                 ins.op >= OP_JMP &&
+                 ins.op <= OP_JGE &&
+                 isLocalLabel(ins.name))
+        {
+            uint32_t end = findChainEnd(first, ends, ins.name);
+            if (end != 0)
+            {
+                ins.name = end;
+                rule     = PR_CHAIN;
+            }
+        }
+        else if (rules & PR_BIT(PR_COMPARE) && isSameCompare(i))
+        {
+            dead[i] = 1;
+            rule    = PR_COMPARE;
+        }
+
+        if (rule != PR_MAX)
+        {
+            ++counts.rule[rule];
+            ++total;
+        }
+    }
+
+    // Anything removed has no effect, so a label that started
+    // on it now starts on the instruction that follows it.
+    size_t kept = 0;
+    for (i = 0; i < n; ++i)
+    {
+        if (!dead[i])
+            m_ins[kept++] = m_ins[i];
+    }
+    m_ins.resize(kept);
+    return total;
+}
+
+size_t Optimizer::peephole(int rules, PeepholeCounts& counts)
+{
+    size_t total = 0, pass;
+    do
+    {
+        pass = peepholePass(rules, counts);
+        total += pass;
+    } while (pass != 0);
+    return total;
+}
+
+static const char* RuleNames[PR_MAX] = {
+    "move",
+    "identity",
+    "next",
+    "chain",
+    "compare",
+};
+
+const char* Optimizer::getRuleName(int rule)
+{
+    if (rule >= 0 && rule < PR_MAX)
+        return RuleNames[rule];
+    return "";
+}
+
+int Optimizer::findRule(const char* name)
+{
+    int rule;
+    for (rule = 0; rule < PR_MAX; ++rule)
+    {
+        if (strcmp(name, RuleNames[rule]) == 0)
+            return rule;
+    }
+    return -1;
+}
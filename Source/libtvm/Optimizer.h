@@ -0,0 +1,111 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Optimizer_h_
+#define _Optimizer_h_
+
+#include "Declarations.h"
+
+enum PeepholeRule
+{
+    PR_MOVE,      // mov xN, xN
+    PR_IDENTITY,  // add 0, sub 0, mul 1, div 1, shl 0 and shr 0
+    PR_NEXT,      // b to the instruction that follows it
+    PR_CHAIN,     // a branch to a label that starts with b
+    PR_COMPARE,   // cmp that repeats the one in front of its branches
+    PR_MAX,
+};
+
+#define PR_BIT(n) (1 << (n))
+#define PR_ALL (PR_BIT(PR_MAX) - 1)
+
+struct PeepholeCounts
+{
+    size_t rule[PR_MAX];  // rewrites made by each PeepholeRule
+};
+
+class Optimizer
+{
+private:
+    using LabelStarts = std::vector<uint64_t>;
+
+    // The end of the chain of b instructions that starts at
+    // each label, found once per pass.
+    using ChainEnds = std::vector<uint32_t>;
+
+    Instructions&    m_ins;
+    const NameInfos& m_names;
+
+    bool isLocalLabel(uint32_t name);
+    bool isLabelStart(size_t idx);
+    bool isSelfMove(const Instruction& ins);
+    bool isIdentity(const Instruction& ins);
+    bool isSameCompare(size_t idx);
+
+    // The first instruction of each label. A label with
+    // nothing under it shares the start of the next one.
+    void findLabelStarts(LabelStarts& first);
+
+    // The first instruction of a local label, or NO_INDEX
+    // if no instruction follows it.
+    uint64_t findStart(const LabelStarts& first, uint32_t name);
+
+    // Follows b instructions from the label name to the end
+    // of the chain, however long it is. Returns the label of
+    // the last one, or zero if there is no chain or it loops.
+    // Every label on the way is recorded in ends.
+    uint32_t findChainEnd(const LabelStarts& first, ChainEnds& ends, uint32_t name);
+
+    size_t peepholePass(int rules, PeepholeCounts& counts);
+
+public:
+    Optimizer(Instructions& ins, const NameInfos& names);
+    ~Optimizer();
+
+    // Rewrites 'bl label; ret' and 'bl label; ldp sp, N; ret'
+    // into jumps that reuse the caller's return slot.
+    // Returns the number of rewritten calls.
+    size_t tailCalls(void);
+
+    // Removes the functions that cannot be reached from the
+    // label entry. A function starts at a call target and runs
+    // up to the next one. It is kept if any kept code refers to
+    // one of its labels, or if the function in front of it can
+    // fall through into it. Nothing is removed from code that
+    // writes pc. Returns the number of removed instructions.
+    size_t unreferencedFunctions(uint32_t entry);
+
+    // Runs the PR_BIT(PeepholeRule) set in rules until none of
+    // them apply. An instruction that is removed is one that
+    // has no effect, so a label in front of it moves on to the
+    // next instruction. Rules that look at more than one
+    // instruction do not look across a label. The rewrites are
+    // added to counts, and the total is returned.
+    size_t peephole(int rules, PeepholeCounts& counts);
+
+    // The name of a PeepholeRule, as given to tcom.
+    static const char* getRuleName(int rule);
+
+    // Returns the PeepholeRule with the name, or -1.
+    static int findRule(const char* name);
+};
+
+#endif  //_Optimizer_h_
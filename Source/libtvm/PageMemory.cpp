@@ -0,0 +1,89 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "PageMemory.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+inline size_t getMappedSize(size_t nr, int mode)
+{
+    // Huge pages only back whole 2 MB blocks,
+    // so the size is rounded up to one.
+    if (mode == PM_HUGE)
+        return (nr + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+    return nr;
+}
+
+void* MapPages(size_t nr, int mode)
+{
+    if (nr == 0)
+        return nullptr;
+
+    size_t len = getMappedSize(nr, mode);
+
+#ifdef _WIN32
+    // Large pages need a privilege that most accounts do
+    // not have, so Windows always uses regular pages.
+    return VirtualAlloc(nullptr, len, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    if (mode != PM_HUGE)
+    {
+        void* buf = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return buf != MAP_FAILED ? buf : nullptr;
+    }
+
+    // Over allocate by one huge page, then trim
+    // the block to start on a huge page boundary.
+    size_t   over = len + HUGE_PAGE_SIZE;
+    uint8_t* buf  = (uint8_t*)mmap(nullptr, over, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED)
+        return nullptr;
+
+    size_t head = (HUGE_PAGE_SIZE - (size_t)buf % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+    if (head != 0)
+        munmap(buf, head);
+    if (over - head - len != 0)
+        munmap(buf + head + len, over - head - len);
+
+    buf += head;
+#ifdef MADV_HUGEPAGE
+    // This fails when transparent huge pages are disabled
+    // or not supported, which leaves regular pages.
+    madvise(buf, len, MADV_HUGEPAGE);
+#endif
+    return buf;
+#endif
+}
+
+void UnmapPages(void* ptr, size_t nr, int mode)
+{
+    if (ptr == nullptr)
+        return;
+
+#ifdef _WIN32
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, getMappedSize(nr, mode));
+#endif
+}
@@ -0,0 +1,110 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _PageMemory_h_
+#define _PageMemory_h_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include <type_traits>
+
+enum PageMode
+{
+    PM_DEFAULT,  // regular pages
+    PM_HUGE,     // 2 MB aligned, and backed by huge pages when possible
+};
+
+#define HUGE_PAGE_SIZE 0x200000
+
+// Maps nr bytes of zeroed memory that is only committed when it
+// is first touched. With PM_HUGE, the block starts on a huge page
+// boundary and the system is asked to back it with huge pages.
+// If it cannot, the block is still usable with regular pages.
+// Returns nullptr if the memory could not be mapped.
+extern void* MapPages(size_t nr, int mode = PM_DEFAULT);
+
+// Releases a block from MapPages. The size and
+// mode need to be the same as when it was mapped.
+extern void UnmapPages(void* ptr, size_t nr, int mode = PM_DEFAULT);
+
+// Allocates large blocks with MapPages when the mode is PM_HUGE,
+// and everything else from the heap.
+template <typename T>
+class PageAllocator
+{
+public:
+    using value_type = T;
+
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    int mode;
+
+    PageAllocator(int pageMode = PM_DEFAULT) :
+        mode(pageMode)
+    {
+    }
+
+    template <typename U>
+    PageAllocator(const PageAllocator<U>& oth) :
+        mode(oth.mode)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (!isMapped(n))
+            return (T*)::operator new(n * sizeof(T));
+
+        void* ptr = MapPages(n * sizeof(T), mode);
+        if (ptr == nullptr)
+            throw std::bad_alloc();
+        return (T*)ptr;
+    }
+
+    void deallocate(T* ptr, size_t n)
+    {
+        if (isMapped(n))
+            UnmapPages(ptr, n * sizeof(T), mode);
+        else
+            ::operator delete(ptr);
+    }
+
+    bool operator==(const PageAllocator& oth) const
+    {
+        return mode == oth.mode;
+    }
+
+    bool operator!=(const PageAllocator& oth) const
+    {
+        return mode != oth.mode;
+    }
+
+private:
+    bool isMapped(size_t n) const
+    {
+        return mode == PM_HUGE && n * sizeof(T) >= HUGE_PAGE_SIZE;
+    }
+};
+
+#endif  //_PageMemory_h_
@@ -26,30 +26,51 @@
 #include <iostream>
 #include "Declarations.h"
 #include "Keywords.inl"
+#include "TextScan.h"
 
 using namespace std;
 
 Parser::Parser() :
     m_state(0),
     m_section(-1),
-    m_label(-1),
     m_lineNo(1),
-    m_labels(),
-    m_instructions(),
     m_fname(),
-    m_disableErrorFormat(false)
+    m_disableErrorFormat(false),
+    m_bufferErrors(false),
+    m_errors(),
+    m_unit(),
+    m_escape()
 {
+    reset();
 }
 
 Parser::~Parser()
 {
 }
 
+void Parser::reset(void)
+{
+    m_unit        = CompileUnit();
+    m_unit.labels = 0;
+    m_errors.clear();
+
+    // the empty name is index zero
+    intern(std::string_view());
+}
+
+uint32_t Parser::intern(const std::string_view& name)
+{
+    uint32_t idx = m_unit.names.intern(name);
+    if (idx >= m_unit.info.size())
+        m_unit.info.resize((size_t)idx + 1);
+    return idx;
+}
+
 int32_t Parser::open(const char* fname)
 {
     m_reader.open(fname);
+    reset();
     m_section = SEC_TXT;
-    m_label   = 0;
     m_state   = ST_INITIAL;
     m_fname   = fname;
     return m_reader.eof() ? (int32_t)PS_ERROR : (int32_t)PS_OK;
@@ -58,12 +79,12 @@ int32_t Parser::open(const char* fname)
 int32_t Parser::parse(const char* fname)
 {
     m_reader.open(fname);
+    reset();
     if (!m_reader.eof())
     {
         int32_t rc;
 
         m_section = SEC_TXT;
-        m_label   = 0;
         m_state   = ST_INITIAL;
         m_fname   = fname;
 
@@ -75,6 +96,7 @@ int32_t Parser::parse(const char* fname)
                 rc = parseTextState();
                 break;
             case SEC_DAT:
+            case SEC_ROD:
                 rc = parseDataState();
                 break;
             default:
@@ -141,9 +163,10 @@ int32_t Parser::parseDataState(void)
 
     Token t1, t2, t3;
     scan(t1);
-    if (t1.type == TOK_SECTION && t1.sectype == SEC_TXT)
+    if (t1.type == TOK_SECTION &&
+        (t1.sectype == SEC_TXT || t1.sectype == SEC_DAT || t1.sectype == SEC_ROD))
     {
-        m_section = SEC_TXT;
+        m_section = t1.sectype;
         return PS_OK;
     }
     else if (t1.type == TOK_SECTION)
@@ -157,6 +180,8 @@ int32_t Parser::parseDataState(void)
         return PS_ERROR;
     }
 
+    const uint32_t name = intern(t1.value);
+
     scan(t2);
     if (t2.type != TOK_SECTION)
     {
@@ -173,27 +198,63 @@ int32_t Parser::parseDataState(void)
     scan(t3);
 
     if (t3.type == TOK_ASCII)
-        decl.sval = t3.value;
+        decl.sval = m_unit.strings.store(t3.value);
     else if (t3.type == TOK_DIGIT)
+    {
         decl.ival = t3.ival.x;
+        decl.values.push_back(t3.ival.x);
+
+        // integer types accept a comma separated list
+        while (t3.hasComma && t2.sectype >= SEC_BYTE && t2.sectype <= SEC_QUAD)
+        {
+            scan(t3);
+            if (t3.type != TOK_DIGIT)
+            {
+                error("expected a value to follow ',' in '%s'\n",
+                      m_unit.names.c_str(name));
+                return PS_ERROR;
+            }
+            decl.values.push_back(t3.ival.x);
+        }
+
+        if (t3.hasComma)
+        {
+            error("'%s' does not accept a list of values\n",
+                  m_unit.names.c_str(name));
+            return PS_ERROR;
+        }
+    }
     else
     {
-        getTokenName(t3.value, t3.type);
+        str_t type;
+        getTokenName(type, t3.type);
         error("unknown type declaration for '%s' -> '%s'\n",
-              t1.value.c_str(),
-              t3.value.c_str());
+              m_unit.names.c_str(name),
+              type.c_str());
         return PS_ERROR;
     }
 
-    decl.lname = t1.value;
-    decl.type  = t2.sectype;
+    decl.name     = name;
+    decl.type     = t2.sectype;
+    decl.readonly = m_section == SEC_ROD;
 
-    if (!hasDataDeclaration(t1.value))
-        m_dataDecl[t1.value] = decl;
+    if (decl.readonly && decl.type == SEC_ZERO)
+    {
+        error("'%s' cannot be a .zero block in a read-only section\n",
+              m_unit.names.c_str(name));
+        return PS_ERROR;
+    }
+
+    NameInfo& info = m_unit.info[name];
+    if (info.data == 0 && info.label == 0)
+    {
+        m_unit.data.push_back(std::move(decl));
+        info.data = (uint32_t)m_unit.data.size();
+    }
     else
     {
         error("duplicate data declaration for '%s'\n",
-              t1.value.c_str());
+              m_unit.names.c_str(name));
         rc = PS_ERROR;
     }
     return rc;
@@ -246,14 +307,9 @@ int32_t Parser::handleInitialState(Token& tok)
         scanEol();
     else if (isNewLine(ch))
     {
-        do
-        {
-            countNewLine(ch);
-            ch = m_reader.next();
-        } while (isNewLine(ch));
-
-        if (ch != 0)
-            m_reader.offset(-1);
+        // the whole run of blank lines is counted at once
+        m_reader.offset(-1);
+        m_reader.skip(SkipNewLines(m_reader.cursor(), m_reader.remaining(), m_lineNo));
     }
     else
     {
@@ -296,12 +352,13 @@ int32_t Parser::handleIdState(Token& tok)
 
         if (isAlpha(ch))
         {
-            do
-            {
-                tok.value.push_back(ch);
-                ch = m_reader.next();
-            } while (isAlphaNumeric(ch));
+            m_reader.offset(-1);
+
+            size_t len = SkipIdentifier(m_reader.cursor(), m_reader.remaining());
+            tok.value = std::string_view((const char*)m_reader.cursor(), len);
+            m_reader.skip(len);
 
+            ch = m_reader.next();
             if (isTerminator(ch))
                 st = handleTermination(tok, ch);
             else if (ch == ':')
@@ -333,6 +390,10 @@ int32_t Parser::handleDigitState(Token& tok)
         int  base    = 10;
         bool convert = ch == '0';
 
+        // the digits are converted where they are in the source
+        const uint8_t* digits = m_reader.cursor() - 1;
+        size_t         len    = 0;
+
         while (isEncodedNumber(ch) && st != PS_ERROR)
         {
             if (base == 2 &&
@@ -345,7 +406,7 @@ int32_t Parser::handleDigitState(Token& tok)
             }
             else
             {
-                tok.value.push_back(ch);
+                ++len;
                 ch = m_reader.next();
 
                 if (convert && base == 10)
@@ -368,11 +429,9 @@ int32_t Parser::handleDigitState(Token& tok)
             tok.type = TOK_DIGIT;
 
             if (convert)
-                tok.ival.x = std::strtoull(tok.value.c_str() + 2, nullptr, base);
+                tok.ival.x = ScanInteger(digits + 2, len - 2, base);
             else
-                tok.ival.x = std::strtoull(tok.value.c_str(), nullptr, base);
-
-            tok.value.clear();
+                tok.ival.x = ScanInteger(digits, len, base);
             st = ST_MAX;
         }
     }
@@ -393,23 +452,44 @@ int32_t Parser::handleAsciiState(Token& tok)
     int32_t ch = m_reader.next();
     if (ch == '"')
     {
+        // Strings are sliced from the source unless they contain an
+        // escape sequence, in which case they are rebuilt in m_escape
+        // and kept in the arena.
+        const uint8_t* str     = m_reader.cursor();
+        size_t         len     = 0;
+        bool           escaped = false;
+
         ch = m_reader.next();
         while (ch != '"' && ch != 0 && st != PS_ERROR)
         {
             if (ch == '\\')
             {
+                if (!escaped)
+                {
+                    m_escape.assign((const char*)str, len);
+                    escaped = true;
+                }
+
                 ch = m_reader.next();
                 ch = parseEscapeSequence(ch);
                 if (ch == PS_ERROR)
                     st = PS_ERROR;
             }
 
-            tok.value.push_back(ch);
+            if (escaped)
+                m_escape.push_back((char)ch);
+            else
+                ++len;
             ch = m_reader.next();
         }
 
         if (st != PS_ERROR)
         {
+            if (escaped)
+                tok.value = m_unit.strings.store(m_escape);
+            else
+                tok.value = std::string_view((const char*)str, len);
+
             m_state  = ST_INITIAL;
             tok.type = TOK_ASCII;
             st       = ST_MAX;
@@ -489,75 +569,24 @@ int32_t Parser::handleTermination(Token& tok, uint8_t ch)
 
     m_state = ST_INITIAL;
 
-    size_t sz = tok.value.size();
-    if (sz > 1)
+    const Lexeme* lex = findLexeme(tok.value.data(), tok.value.size());
+    if (lex != nullptr)
     {
-        uint8_t v0 = tok.value[0];
-        uint8_t v1 = tok.value[1];
-        uint8_t v2 = sz > 2 ? tok.value[2] : 0;
-
-        if (isDigit(v1))
-        {
-            if (v0 == 'x' || v0 == 'b' || v0 == 'w' || v0 == 'l')
-            {
-                switch (v0)
-                {
-                case 'b':
-                    tok.regtype = IF_BTEB;
-                    break;
-                case 'w':
-                    tok.regtype = IF_BTEW;
-                    break;
-                case 'l':
-                    tok.regtype = IF_BTEL;
-                    break;
-                case 'x':
-                default:
-                    break;
-                }
-
-                tok.type = TOK_REGISTER;
-                tok.reg  = v1 - '0';
-
-                if (isDigit(v2))
-                {
-                    tok.reg *= 10;
-                    tok.reg += v2 - '0';
-                }
-                tok.value.clear();
-                return ST_MAX;
-            }
-        }
-        else if (v0 == 's' && v1 == 'p')
-        {
-            tok.type    = TOK_REGISTER;
-            tok.reg     = 0;
-            tok.regtype = IF_STKP;
-            tok.value.clear();
-            return ST_MAX;
-        }
-        else if (v0 == 'p' && v1 == 'c')
+        tok.value = std::string_view();
+        if (lex->type == LT_REGISTER)
         {
             tok.type    = TOK_REGISTER;
-            tok.reg     = 0;
-            tok.regtype = IF_INSP;
-            tok.value.clear();
-            return ST_MAX;
+            tok.reg     = lex->value;
+            tok.regtype = lex->regtype;
         }
-    }
-
-    size_t i = 0;
-    for (i = 0; i < KeywordTableSize; ++i)
-    {
-        if (strncmp(KeywordTable[i].word, tok.value.c_str(), MAX_KWD) == 0)
+        else
         {
             // swap the string with the opcode
-            tok.value.clear();
-            tok.op    = KeywordTable[i].op;
+            tok.op    = KeywordTable[lex->value].op;
             tok.type  = TOK_OPCODE;
-            tok.index = (int32_t)i;
-            return ST_MAX;
+            tok.index = (int32_t)lex->value;
         }
+        return ST_MAX;
     }
 
     tok.type = TOK_IDENTIFIER;
@@ -625,7 +654,7 @@ int32_t Parser::handleCharacter(Token& tok, uint8_t ch)
     m_state    = ST_INITIAL;
     tok.type   = TOK_DIGIT;
     tok.ival.x = (int)v;
-    tok.value.clear();
+    tok.value  = std::string_view();
     return ST_MAX;
 }
 
@@ -640,12 +669,16 @@ int32_t Parser::handleSectionState(Token& tok)
 
     if (isAlphaL(ch))
     {
+        const uint8_t* name = m_reader.cursor() - 1;
+        size_t         len  = 0;
         do
         {
-            tok.value.push_back(ch);
+            ++len;
             ch = m_reader.next();
         } while (isAlpha(ch));
 
+        tok.value = std::string_view((const char*)name, len);
+
         if (isNewLine(ch))
             m_reader.offset(-1);
 
@@ -662,8 +695,12 @@ int32_t Parser::handleSectionState(Token& tok)
 uint8_t Parser::scanEol(void)
 {
     uint8_t ch = m_reader.current();
-    while (ch != '\n' && ch != '\r' && ch != 0)
+    if (ch != '\n' && ch != '\r' && ch != 0)
+    {
+        // skip to the end of the line, and consume it
+        m_reader.skip(FindLineEnd(m_reader.cursor(), m_reader.remaining()));
         ch = m_reader.next();
+    }
     countNewLine(ch);
     return ch;
 }
@@ -709,8 +746,11 @@ void Parser::prepNextCall(Token& tok, uint8_t ch)
 
 uint8_t Parser::eatWhiteSpace(uint8_t ch)
 {
-    while (isWhiteSpace(ch))
+    if (isWhiteSpace(ch))
+    {
+        m_reader.skip(SkipWhiteSpace(m_reader.cursor(), m_reader.remaining()));
         ch = m_reader.next();
+    }
     return ch;
 }
 
@@ -719,7 +759,9 @@ int32_t Parser::handleSection(const Token& tok)
     m_section = tok.sectype;
     if (m_section == PS_UNDEFINED)
     {
-        error("undefined section '%s'\n", tok.value.c_str());
+        error("undefined section '%.*s'\n",
+              (int)tok.value.size(),
+              tok.value.data());
         return PS_ERROR;
     }
     return PS_OK;
@@ -729,15 +771,18 @@ int32_t Parser::handleLabel(const Token& label)
 {
     if (label.type == TOK_LABEL)
     {
-        if (m_labels.find(label.value) != m_labels.end())
+        NameInfo& info = m_unit.info[intern(label.value)];
+        if (info.label != 0)
         {
-            error("duplicate label '%s'\n", label.value.c_str());
+            error("duplicate label '%.*s'\n",
+                  (int)label.value.size(),
+                  label.value.data());
             return PS_ERROR;
         }
 
         // This will be resolved after all text has been parsed.
         // For now this just needs to map to a unique index.
-        m_labels[label.value] = ++m_label;
+        info.label = ++m_unit.labels;
     }
     else
     {
@@ -782,6 +827,9 @@ void Parser::markArgumentAsRegister(Instruction& ins, const Token& tok, int idx)
     case IF_BTEL:
         ins.flags |= IF_BTEL;
         break;
+    case IF_BTEQ:
+        ins.flags |= IF_BTEQ;
+        break;
     default:
         break;
     }
@@ -832,7 +880,7 @@ int32_t Parser::handleArgument(Instruction&      ins,
         {
             markArgumentAsRegister(ins, tok, idx);
             ins.flags |= IF_ADRD;
-            ins.lname = tok.value;
+            ins.name = intern(tok.value);
         }
         else
         {
@@ -860,7 +908,7 @@ int32_t Parser::handleArgument(Instruction&      ins,
         // save this now so it can be resolved after all
         // labels have been stored
         ins.flags |= IF_ADDR;
-        ins.lname = tok.value;
+        ins.name = intern(tok.value);
     }
     else
     {
@@ -880,7 +928,7 @@ int32_t Parser::handleOpCode(const Token& tok)
         Instruction ins = {};
         ins.op          = kwd.op;
         ins.argc        = kwd.narg;
-        ins.label       = m_label;
+        ins.label       = m_unit.labels;
 
         Token lastTok = {};
         int   arg     = 0;
@@ -919,22 +967,24 @@ int32_t Parser::handleOpCode(const Token& tok)
             return PS_ERROR;
         }
 
-        m_instructions.push_back(ins);
+        m_unit.ins.push_back(ins);
         return PS_OK;
     }
     return PS_ERROR;
 }
 
-int32_t Parser::getSection(const str_t& val)
+int32_t Parser::getSection(const std::string_view& val)
 {
     if (val == "data")
         return SEC_DAT;
     else if (val == "text")
         return SEC_TXT;
+    else if (val == "rodata")
+        return SEC_ROD;
     else if (val == "asciz")
         return SEC_ASCII;
     else if (val == "byte")
-        return SEC_ASCII;
+        return SEC_BYTE;
     else if (val == "word")
         return SEC_WORD;
     else if (val == "long")
@@ -948,13 +998,12 @@ int32_t Parser::getSection(const str_t& val)
     return PS_UNDEFINED;
 }
 
-bool Parser::hasDataDeclaration(const str_t& str)
+const DataDeclaration* Parser::findDataDeclaration(const std::string_view& name) const
 {
-    if (m_dataDecl.find(str) != m_dataDecl.end())
-        return true;
-    else if (m_labels.find(str) != m_labels.end())
-        return true;
-    return false;
+    int64_t idx = m_unit.names.find(name);
+    if (idx > 0 && m_unit.info[(size_t)idx].data != 0)
+        return &m_unit.data[m_unit.info[(size_t)idx].data - 1];
+    return nullptr;
 }
 
 int32_t Parser::getKeywordIndex(const uint8_t& val)
@@ -1107,21 +1156,17 @@ void Parser::error(const char* fmt, ...)
                 s2 = std::vsnprintf(buffer, (size_t)s1 + 1, fmt, l1);
                 va_end(l1);
 
+                str_t msg;
                 if (!m_disableErrorFormat)
-                {
-                    fprintf(stdout,
-                            "%s(%i): error : %s",
-                            m_fname.c_str(),
-                            m_lineNo,
-                            buffer);
-                }
+                    msg = m_fname;
+
+                msg += "(" + std::to_string(m_lineNo) + "): error : ";
+                msg += buffer;
+
+                if (m_bufferErrors)
+                    m_errors += msg;
                 else
-                {
-                    fprintf(stdout,
-                            "(%i): error : %s",
-                            m_lineNo,
-                            buffer);
-                }
+                    fputs(msg.c_str(), stdout);
 
                 free(buffer);
             }
@@ -23,21 +23,22 @@
 #define _Parser_h_
 
 #include "BlockReader.h"
+#include "CompileUnit.h"
 #include "Declarations.h"
 
 class Parser
 {
 private:
-    BlockReader  m_reader;
-    int32_t      m_state;
-    int32_t      m_section;
-    int32_t      m_label;
-    int32_t      m_lineNo;
-    LabelMap     m_labels;
-    Instructions m_instructions;
-    str_t        m_fname;
-    bool         m_disableErrorFormat;
-    DataLookup   m_dataDecl;
+    BlockReader m_reader;
+    int32_t     m_state;
+    int32_t     m_section;
+    int32_t     m_lineNo;
+    str_t       m_fname;
+    bool        m_disableErrorFormat;
+    bool        m_bufferErrors;
+    str_t       m_errors;
+    CompileUnit m_unit;
+    str_t       m_escape;  // scratch space for escaped strings
 
 public:
     Parser();
@@ -48,26 +49,42 @@ public:
     int32_t open(const char* fname);
     int32_t scan(Token& tok);
 
-    const Instructions& getInstructions(void)
+    // The parsed file. It may be moved out once parse returns.
+    CompileUnit& getUnit(void)
     {
-        return m_instructions;
+        return m_unit;
     }
 
-    const LabelMap& getLabels(void)
+    Instructions& getInstructions(void)
     {
-        return m_labels;
+        return m_unit.ins;
     }
 
-    const DataLookup& getDataDeclarations(void)
+    const DataDeclarations& getDataDeclarations(void) const
     {
-        return m_dataDecl;
+        return m_unit.data;
     }
 
+    // Returns the declaration with the supplied name, or nullptr.
+    const DataDeclaration* findDataDeclaration(const std::string_view& name) const;
+
     void disableErrorFormat(bool v)
     {
         m_disableErrorFormat = v;
     }
 
+    // Keeps error messages in getErrors instead of printing them,
+    // so that files parsed together can report in order.
+    void bufferErrors(bool v)
+    {
+        m_bufferErrors = v;
+    }
+
+    const str_t& getErrors(void) const
+    {
+        return m_errors;
+    }
+
 private:
     int32_t handleOpCode(const Token& tok);
     int32_t handleSection(const Token& tok);
@@ -89,7 +106,8 @@ private:
     int32_t parseTextState(void);
     int32_t parseDataState(void);
 
-    bool hasDataDeclaration(const str_t& str);
+    void     reset(void);
+    uint32_t intern(const std::string_view& name);
 
     void markArgumentAsRegister(Instruction& ins, const Token& tok, int idx);
     void countNewLine(uint8_t ch);
@@ -97,7 +115,7 @@ private:
     void errorTokenType(int tok);
     void errorArgType(int idx, int tok, const char* inst);
 
-    int32_t           getSection(const str_t& val);
+    int32_t           getSection(const std::string_view& val);
     int32_t           getKeywordIndex(const uint8_t& val);
     const KeywordMap& getKeyword(const int32_t& val);
 
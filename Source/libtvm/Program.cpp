@@ -22,6 +22,7 @@
 #include "Program.h"
 #include <stdint.h>
 #include <string.h>
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include <iostream>
@@ -30,27 +31,171 @@
 #include <vector>
 #include "BlockReader.h"
 #include "Declarations.h"
+#include "LZCodec.h"
+#include "LoadProfile.h"
 #include "SharedLib.h"
 #include "SymbolUtils.h"
 
 using namespace std;
 
-const size_t MaxRegisterSize = sizeof(Register) * (MAX_REG - 1);
+const size_t   MaxRegisterSize = sizeof(Register) * (MAX_REG - 1);
+const uint16_t MaxRegisterMask = SYM_REGS;
+const size_t   DataBlockSize   = 0x1000000;
+const uint64_t MaxDataSize     = (uint64_t)1 << 40;
+const size_t   LoadChunkSize   = 0x10000;
+const size_t   MinInsSize      = 6;
+const uint32_t HugeStackSize   = HUGE_PAGE_SIZE / sizeof(ArrayStack::Data) - 1;
+
+inline void copyRegisters(Register* dest, const Register* src, uint16_t mask)
+{
+    if (mask == MaxRegisterMask)
+        memcpy(dest, src, MaxRegisterSize);
+    else
+    {
+        int i;
+        for (i = 0; i < MAX_REG - 1; ++i)
+        {
+            if (mask & SYM_REG(i))
+                dest[i] = src[i];
+        }
+    }
+}
+
+inline bool sameRegisters(const Register* a, const Register* b, uint16_t mask)
+{
+    int i;
+    for (i = 0; i < MAX_REG - 1; ++i)
+    {
+        if (mask & SYM_REG(i) && a[i].x != b[i].x)
+            return false;
+    }
+    return true;
+}
+
+inline size_t getArgumentWidth(uint16_t sizes, uint8_t i)
+{
+    if (sizes & SizeFlags[i][0])
+        return 1;
+    if (sizes & SizeFlags[i][1])
+        return 2;
+    if (sizes & SizeFlags[i][2])
+        return 4;
+    return 8;
+}
+
+// Returns the number of bytes used by the encoded instruction
+// at src, or zero if it does not fit in the len bytes.
+inline size_t getInstructionSize(const uint8_t* src, size_t len)
+{
+    if (len < MinInsSize)
+        return 0;
+
+    uint16_t flags, sizes;
+    memcpy(&flags, src + 2, 2);
+    memcpy(&sizes, src + 4, 2);
+
+    size_t  br = flags & IF_RIDX ? MinInsSize + 1 : MinInsSize;
+    uint8_t i;
+    for (i = 0; i < src[1] && i < INS_ARG; ++i)
+        br += getArgumentWidth(sizes, i);
+    return br <= len ? br : 0;
+}
+
+inline size_t decodeInstruction(const uint8_t* src, size_t len, ExecInstruction& exec)
+{
+    exec = {};
+
+    size_t br = getInstructionSize(src, len);
+    if (br == 0)
+        return 0;
+
+    uint16_t sizes;
+    memcpy(&exec.op, src, 2);
+    memcpy(&exec.flags, src + 2, 2);
+    memcpy(&sizes, src + 4, 2);
+
+    const uint8_t* ptr = src + 6;
+    if (exec.flags & IF_RIDX)
+        exec.index = *ptr++;
+
+    uint8_t  i;
+    uint16_t v16;
+    uint32_t v32;
+    for (i = 0; i < exec.argc && i < INS_ARG; ++i)
+    {
+        switch (getArgumentWidth(sizes, i))
+        {
+        case 1:
+            exec.argv[i] = *ptr++;
+            break;
+        case 2:
+            memcpy(&v16, ptr, 2);
+            exec.argv[i] = v16;
+            ptr += 2;
+            break;
+        case 4:
+            memcpy(&v32, ptr, 4);
+            exec.argv[i] = v32;
+            ptr += 4;
+            break;
+        default:
+            memcpy(&exec.argv[i], ptr, 8);
+            ptr += 8;
+            break;
+        }
+    }
+    return br;
+}
+
+inline bool decodeChunk(const uint8_t* base, const CodeChunk& chunk, ExecInstruction* dest)
+{
+    size_t br = chunk.offset, nr, i;
+    for (i = 0; i < chunk.count; ++i)
+    {
+        if ((nr = decodeInstruction(base + br, chunk.end - br, dest[chunk.first + i])) == 0)
+            return false;
+        br += nr;
+    }
+    return br == chunk.end;
+}
 
 Program::Program(const str_t& modpath) :
+    m_image(),
+    m_ins(),
+    m_code(nullptr),
+    m_codeLen(0),
+    m_codeSection(sizeof(TVMHeader)),
+    m_codeStart(0),
+    m_codeSize(0),
+    m_functions(),
+    m_functionNames(nullptr),
+    m_functionNamesLen(0),
+    m_lazy(false),
+    m_verified(false),
     m_header({}),
     m_flags(0),
     m_return(0),
     m_curinst(0),
     m_startinst(0),
     m_strtab(),
-    m_strtablist(),
     m_callStack(),
     m_modpath(modpath),
     m_dynlib(),
     m_symbols(),
+    m_calls(),
+    m_memo(),
+    m_imports(),
+    m_modules(),
+    m_cache(),
+    m_key({}),
     m_dataTable(),
+    m_rodata(nullptr),
+    m_rodataAddr(0),
+    m_rodataLen(0),
     m_stack(),
+    m_profile(),
+    m_pool(),
+    m_pageMode(PM_DEFAULT),
     m_exit(false)
 {
     memset(m_regi, 0, sizeof(Registers));
@@ -73,31 +218,47 @@ int Program::load(const char* fname)
         return PS_ERROR;
     }
 
-    BlockReader reader = BlockReader(fname);
-    if (reader.eof())
+    // The reader is kept open for the life of the program, so
+    // that a fixed code section can be executed in place.
+    BlockReader& reader = m_image;
     {
-        printf("failed to load '%s'\n", fname);
-        return PS_ERROR;
+        LoadTimer timer(m_profile, LP_READ);
+        reader.open(fname);
+        if (reader.eof())
+        {
+            printf("failed to load '%s'\n", fname);
+            return PS_ERROR;
+        }
+        reader.read(&m_header, sizeof(TVMHeader));
     }
 
-    reader.read(&m_header, sizeof(TVMHeader));
     if (m_header.code[0] != 'T' || m_header.code[1] != 'V')
     {
         printf("invalid file type identifier\n");
         return PS_ERROR;
     }
 
-    if (m_header.str != 0)
+    // Every version 2 image indexes its strings and imports.
+    if (m_header.version != TVM_VERSION ||
+        (m_header.str != 0 && !(m_header.flags & HF_STRIDX)) ||
+        (m_header.sym != 0 && !(m_header.flags & HF_IMPORT)))
     {
-        if (loadStringTable(reader) != PS_OK)
-        {
-            printf("failed to read the string table\n");
-            return PS_ERROR;
-        }
+        printf("unsupported file version, the image needs to be recompiled\n");
+        return PS_ERROR;
+    }
+
+    // The digest is taken before the sections are loaded, since
+    // loading them releases the pages that have been read.
+    if (m_cache.enabled())
+    {
+        LoadTimer timer(m_profile, LP_CACHE);
+        Sha256::digest(reader.ptr(), reader.size(), m_key.digest);
+        m_key.size = reader.size();
     }
 
     if (m_header.dat != 0)
     {
+        LoadTimer timer(m_profile, LP_DATA);
         if (loadDataTable(reader) != PS_OK)
         {
             printf("failed to read the data table\n");
@@ -107,6 +268,7 @@ int Program::load(const char* fname)
 
     if (m_header.sym != 0)
     {
+        LoadTimer timer(m_profile, LP_SYMBOL);
         if (loadSymbolTable(reader) != PS_OK)
         {
             printf("failed to read the symbol table\n");
@@ -114,14 +276,123 @@ int Program::load(const char* fname)
         }
     }
 
-    if (loadCode(reader) != PS_OK)
+    if (m_header.flags & HF_FUNC)
     {
-        printf("failed to read the file's instruction table\n");
-        return PS_ERROR;
+        LoadTimer timer(m_profile, LP_FUNCTION);
+        if (loadFunctionTable(reader) != PS_OK)
+        {
+            printf("failed to read the function table\n");
+            return PS_ERROR;
+        }
+    }
+
+    ImageCacheSlots cached;
+    bool            verified = false;
+    if (m_cache.enabled())
+    {
+        LoadTimer timer(m_profile, LP_CACHE);
+        verified = m_cache.find(m_key, cached) == PS_OK;
+    }
+
+    // Functions are decoded when they are first executed, unless
+    // the whole image has to be verified to be recorded in the cache.
+    m_lazy = !m_functions.empty() && (verified || !m_cache.enabled());
+
+    {
+        LoadTimer timer(m_profile, LP_CODE);
+        if (loadCode(reader) != PS_OK)
+        {
+            printf("failed to read the file's instruction table\n");
+            return PS_ERROR;
+        }
+    }
+
+    // A cached image has already been verified, so only
+    // the native calls need to be bound.
+    if (verified)
+    {
+        LoadTimer timer(m_profile, LP_RESOLVE);
+        if (bindCachedSlots(cached) == PS_OK)
+        {
+            m_verified = true;
+            return PS_OK;
+        }
+    }
+
+    if (m_header.str != 0)
+    {
+        LoadTimer timer(m_profile, LP_STRING);
+        if (loadStringTable(reader) != PS_OK)
+        {
+            printf("failed to read the string table\n");
+            return PS_ERROR;
+        }
+    }
+
+    TVMImports::const_iterator imp = m_imports.begin();
+    for (; imp != m_imports.end(); ++imp)
+    {
+        if (imp->name >= m_strtab.size())
+        {
+            printf("failed to read the symbol table\n");
+            return PS_ERROR;
+        }
+    }
+    m_calls.assign(m_imports.size(), nullptr);
+    m_memo.assign(m_imports.size(), {});
+
+    if (!m_lazy)
+    {
+        {
+            LoadTimer timer(m_profile, LP_VERIFY);
+            if (verifyCode(0, m_codeLen) != PS_OK)
+            {
+                printf("failed to read the file's instruction table\n");
+                return PS_ERROR;
+            }
+        }
+
+        if (m_cache.enabled())
+        {
+            LoadTimer timer(m_profile, LP_CACHE);
+            storeCachedSlots();
+        }
     }
     return PS_OK;
 }
 
+void Program::setCacheDirectory(const str_t& dir)
+{
+    m_cache.setDirectory(dir);
+}
+
+void Program::setProfileLoad(bool enable)
+{
+    m_profile.setEnabled(enable);
+}
+
+void Program::setLoadThreads(unsigned threads)
+{
+    m_pool.setThreads(threads);
+}
+
+void Program::setHugePages(bool enable)
+{
+    m_pageMode = enable ? PM_HUGE : PM_DEFAULT;
+    m_ins      = ExecInstructions(PageAllocator<ExecInstruction>(m_pageMode));
+
+    m_stack.setMode(m_pageMode);
+    m_callStack.setMode(m_pageMode);
+    if (enable)
+    {
+        // Each stack fills one huge page.
+        m_stack.clear();
+        m_stack.reserve(HugeStackSize);
+        m_callStack.clear();
+        m_callStack.reserve(HugeStackSize);
+    }
+}
+
 int Program::loadStringTable(BlockReader& reader)
 {
     reader.moveTo(m_header.str);
@@ -131,50 +402,14 @@ int Program::loadStringTable(BlockReader& reader)
     if (strTab.size <= 0)
         return PS_OK;
 
-    str_t    str;
-    uint32_t i, st = PS_OK;
-    size_t   tot = 0;
-    for (i = 0; i < strTab.size && !reader.eof(); ++i)
+    size_t start = reader.tell();
+    if (strTab.size > reader.size() - start ||
+        m_strtab.load(reader.ptr() + start, strTab.size) != PS_OK)
     {
-        char ch = reader.next();
-        if (ch >= 32 && ch <= 127)
-            str.push_back(ch);
-        else if (ch != 0)
-        {
-            printf("unknown character '%c' was found in the string table\n", ch);
-            st = PS_ERROR;
-            i  = strTab.size;
-        }
-        else
-        {
-            if (!str.empty())
-            {
-                if (m_strtab.find(str) != m_strtab.end())
-                {
-                    printf("duplicate string '%s' was found in the string table\n",
-                           str.c_str());
-                    st = PS_ERROR;
-                    i  = strTab.size;
-                }
-                else
-                {
-                    m_strtab[str] = tot++;
-                    m_strtablist.push_back(str);
-                    str.resize(0);
-                }
-            }
-            else
-            {
-                // force an early exit even if
-                // the whole string table has
-                // not been read.
-                if (i + 1 != strTab.size)
-                    st = PS_ERROR;
-                i = strTab.size;
-            }
-        }
+        printf("invalid string table\n");
+        return PS_ERROR;
     }
-    return st;
+    return PS_OK;
 }
 
 int Program::loadSymbolTable(BlockReader& reader)
@@ -186,11 +421,31 @@ int Program::loadSymbolTable(BlockReader& reader)
     if (symtab.size <= 0)
         return PS_OK;
 
+    size_t   len       = (size_t)symtab.size;
+    uint32_t libraries = 0;
+    uint32_t imports   = 0;
+    reader.read(&libraries, sizeof(uint32_t));
+    reader.read(&imports, sizeof(uint32_t));
+
+    size_t used = sizeof(uint32_t) * 2 + (size_t)imports * sizeof(TVMImport);
+    if (used > len)
+        return PS_ERROR;
+
+    m_imports.resize(imports);
+    reader.read(m_imports.data(), m_imports.size() * sizeof(TVMImport));
+    len -= used;
+
+    TVMImports::const_iterator it = m_imports.begin();
+    for (; it != m_imports.end(); ++it)
+    {
+        if (it->library >= libraries)
+            return PS_ERROR;
+    }
+
     str_t    str;
     uint32_t i, st = PS_OK;
-    size_t   tot = 0;
 
-    for (i = 0; i < symtab.size && !reader.eof(); ++i)
+    for (i = 0; i < len && !reader.eof(); ++i)
     {
         char ch = reader.next();
         if (ch >= 32 && ch <= 127)
@@ -199,7 +454,7 @@ int Program::loadSymbolTable(BlockReader& reader)
         {
             printf("unknown character '%c' was found in the string table\n", ch);
             st = PS_ERROR;
-            i  = symtab.size;
+            i  = len;
         }
         else
         {
@@ -208,9 +463,14 @@ int Program::loadSymbolTable(BlockReader& reader)
                 LibHandle lib = nullptr;
                 if (IsModulePresent(str, m_modpath))
                 {
+                    LoadTimer timer(m_profile, LP_LIBRARY, str.c_str());
+
                     lib = LoadSharedLibrary(str, m_modpath);
                     if (lib != nullptr)
+                    {
                         m_dynlib.push_back(lib);
+                        loadModuleTable(lib, str);
+                    }
                 }
 
                 if (!lib)
@@ -219,7 +479,7 @@ int Program::loadSymbolTable(BlockReader& reader)
                            str.c_str(),
                            m_modpath.c_str());
                     st = PS_ERROR;
-                    i  = symtab.size;
+                    i  = len;
                 }
                 str.resize(0);
             }
@@ -228,158 +488,796 @@ int Program::loadSymbolTable(BlockReader& reader)
                 // force an early exit even if
                 // the whole string table has
                 // not been read.
-                if (i + 1 != symtab.size)
+                if (i + 1 != len)
                     st = PS_ERROR;
-                i = symtab.size;
+                i = len;
             }
         }
     }
+
+    if (st == PS_OK && m_dynlib.size() != libraries)
+        st = PS_ERROR;
     return st;
 }
 
+void Program::loadModuleTable(LibHandle lib, const str_t& name)
+{
+    // Modules that export an initialization table get their
+    // attributes recorded. Anything else is looked up by name
+    // in findImport and treated as if it may touch everything.
+    ModuleTable table = {};
+
+    str_t     lookup = name + "_init";
+    LibSymbol sym    = GetSymbolAddress(lib, lookup.c_str());
+    if (sym != nullptr)
+        table.symbols = ((ModuleInit)sym)();
+
+    while (table.symbols != nullptr && table.symbols[table.count].name != nullptr)
+        ++table.count;
+
+    m_modules.push_back(table);
+
+    if (m_cache.enabled())
+        m_key.modules = ImageCache::hash(&m_key.modules,
+                                         sizeof(uint64_t),
+                                         GetModuleStamp(name, m_modpath));
+}
+
+int Program::bindCachedSlots(const ImageCacheSlots& slots)
+{
+    m_calls.assign(slots.size(), nullptr);
+    m_memo.assign(slots.size(), {});
+
+    size_t i;
+    for (i = 0; i < slots.size(); ++i)
+    {
+        const ImageCacheSlot& slot = slots[i];
+        if (slot.module == IC_UNUSED)
+            continue;
+
+        if (slot.module >= m_modules.size() ||
+            slot.index >= m_modules[slot.module].count)
+            return PS_ERROR;
+
+        const SymbolTable& ent = m_modules[slot.module].symbols[slot.index];
+        if (ent.callback == nullptr)
+            return PS_ERROR;
+        m_calls[i] = &ent;
+    }
+    return PS_OK;
+}
+
+int Program::storeCachedSlots(void)
+{
+    ImageCacheSlots slots(m_calls.size(), {IC_UNUSED, 0, 0});
+
+    size_t i;
+    for (i = 0; i < m_calls.size(); ++i)
+    {
+        if (m_calls[i] == nullptr)
+            continue;
+
+        // the entry findImport picked from the import's library
+        const TVMImport&   imp   = m_imports[i];
+        const ModuleTable& table = m_modules[imp.library];
+
+        uint32_t j;
+        bool     found = false;
+        for (j = 0; j < table.count && !found; ++j)
+        {
+            if (&table.symbols[j] == m_calls[i])
+            {
+                slots[i].module = (uint16_t)imp.library;
+                slots[i].index  = j;
+                found           = true;
+            }
+        }
+
+        // symbols found with findImport's fallback cannot be cached
+        if (!found)
+            return PS_UNDEFINED;
+    }
+    return m_cache.store(m_key, slots);
+}
+
 int Program::loadDataTable(BlockReader& reader)
 {
+    // Every size below comes from the image, so each one is
+    // checked against what is left of it before it is used.
+    if (reader.size() < sizeof(TVMSection) ||
+        m_header.dat > reader.size() - sizeof(TVMSection))
+        return PS_ERROR;
+
     reader.moveTo(m_header.dat);
     TVMSection dat;
     reader.read(&dat, sizeof(TVMSection));
 
-    if (dat.size <= 0)
+    // The stored size differs from the runtime size
+    // when the section is compressed.
+    uint64_t stored = dat.size;
+    if (dat.flags & SF_LZ)
+    {
+        if (reader.read(&stored, sizeof(uint64_t)) != sizeof(uint64_t))
+            return PS_ERROR;
+        stored += sizeof(uint64_t);
+    }
+
+    size_t start = (size_t)m_header.dat + sizeof(TVMSection);
+    if (dat.size > MaxDataSize || stored > reader.size() - start)
+        return PS_ERROR;
+
+    uint64_t data = dat.size + (16 - dat.size % 16) % 16;
+    uint64_t bss  = 0;
+    uint64_t next = start + stored + dat.align;
+
+    if (m_header.flags & HF_BSS)
+    {
+        if (next > reader.size() - sizeof(TVMSection))
+            return PS_ERROR;
+
+        reader.moveTo((size_t)next);
+        TVMSection sec;
+        reader.read(&sec, sizeof(TVMSection));
+
+        // the sum of both stays below MaxDataSize
+        if (sec.size > MaxDataSize - data)
+            return PS_ERROR;
+        bss = sec.size;
+        next += sizeof(TVMSection);
+    }
+
+    if (m_header.flags & HF_RODATA)
+    {
+        if (next > reader.size() - sizeof(TVMSection))
+            return PS_ERROR;
+
+        reader.moveTo((size_t)next);
+        TVMSection sec;
+        reader.read(&sec, sizeof(TVMSection));
+
+        if (sec.start < data + bss || sec.size > reader.size() - reader.tell())
+            return PS_ERROR;
+
+        // The read-only data is used in place. When the image
+        // is mapped, its pages are shared with every other
+        // process that runs the same file.
+        m_rodata     = reader.ptr() + reader.tell();
+        m_rodataAddr = sec.start;
+        m_rodataLen  = sec.size;
+    }
+
+    if (data + bss == 0)
         return PS_OK;
 
-    m_dataTable.reserve((size_t)dat.size + (size_t)dat.align);
-    reader.read(m_dataTable.ptr(), m_dataTable.capacity());
+    // The BSS section follows the data in the same block. It is
+    // never stored in the image, and the block is mapped so that
+    // only the pages that get used are ever committed.
+    if (bss != 0 || m_pageMode == PM_HUGE)
+        m_dataTable.map((size_t)(data + bss), m_pageMode);
+    else
+    {
+        m_dataTable.reserve((size_t)data);
+        memset(m_dataTable.ptr(), 0, (size_t)data);
+    }
+
+    if (dat.flags & SF_LZ)
+    {
+        reader.moveTo(start);
+        return expandSection(reader, m_dataTable.ptr(), (size_t)dat.size);
+    }
+
+    // The data is copied a block at a time, and the pages that
+    // have been copied are released from the mapped image, so
+    // a large section is never resident twice.
+    uint8_t* dest = m_dataTable.ptr();
+    size_t   left = (size_t)dat.size;
+
+    reader.moveTo(start);
+    while (left > 0)
+    {
+        size_t nr = std::min<size_t>(left, DataBlockSize);
+        if (reader.read(dest, nr) != nr)
+            return PS_ERROR;
+
+        reader.discard(start, reader.tell() - start);
+        dest += nr;
+        left -= nr;
+    }
     return PS_OK;
 }
 
-int Program::loadCode(BlockReader& reader)
+int Program::expandSection(BlockReader& reader, uint8_t* dest, size_t size)
+{
+    uint64_t len = 0;
+    reader.read(&len, sizeof(uint64_t));
+
+    size_t start = reader.tell();
+    if (len > reader.size() - start)
+        return PS_ERROR;
+
+    // One pass from the image into the runtime buffer. The
+    // compressed pages are not needed again afterwards.
+    int rc = LZCodec::decompress(reader.ptr() + start, (size_t)len, dest, size);
+    reader.discard(start, (size_t)len);
+    return rc;
+}
+
+int Program::loadFunctionTable(BlockReader& reader)
 {
     reader.moveTo(sizeof(TVMHeader));
+    TVMSection sec;
+    reader.read(&sec, sizeof(TVMSection));
+
+    size_t   start = reader.tell();
+    uint64_t count = 0;
+    if (sec.size < sizeof(uint64_t) || sec.size > reader.size() - start)
+        return PS_ERROR;
+
+    reader.read(&count, sizeof(uint64_t));
+    if (count == 0 || count > (sec.size - sizeof(uint64_t)) / sizeof(TVMFunction))
+        return PS_ERROR;
+
+    m_functions.resize((size_t)count);
+    reader.read(m_functions.data(), m_functions.size() * sizeof(TVMFunction));
+
+    // The names are used in place.
+    m_functionNames    = (const char*)reader.ptr() + reader.tell();
+    m_functionNamesLen = start + sec.size - reader.tell();
+    if (m_functionNamesLen == 0 || m_functionNames[m_functionNamesLen - 1] != 0)
+        return PS_ERROR;
+
+    TVMFunctions::iterator it = m_functions.begin();
+    for (; it != m_functions.end(); ++it)
+    {
+        if (it->name >= m_functionNamesLen || it->count == 0)
+            return PS_ERROR;
+
+        // they have to cover the code without any gaps
+        if (it == m_functions.begin())
+        {
+            if (it->start != 0 || it->offset != 0)
+                return PS_ERROR;
+        }
+        else if ((uint64_t)it->start != (uint64_t)(it - 1)->start + (it - 1)->count ||
+                 it->offset <= (it - 1)->offset)
+            return PS_ERROR;
+    }
+
+    // The code section header has to follow the padding.
+    uint64_t next = start + sec.size;
+    if (sec.align > reader.size() - next ||
+        sizeof(TVMSection) > reader.size() - next - sec.align)
+        return PS_ERROR;
+
+    m_codeSection = (size_t)(next + sec.align);
+    return PS_OK;
+}
+
+int Program::loadCode(BlockReader& reader)
+{
+    if (m_codeSection > reader.size() - sizeof(TVMSection))
+    {
+        printf("misaligned instructions\n");
+        return PS_ERROR;
+    }
+
+    reader.moveTo(m_codeSection);
     TVMSection code;
     reader.read(&code, sizeof(TVMSection));
 
     if (code.size <= 0)
         return PS_OK;
 
-    uint8_t  v8, i;
-    uint16_t v16, sizes = 0;
-    uint32_t v32;
-    size_t   br = 0;
+    m_codeStart = reader.tell();
+    m_codeSize  = code.size;
 
-    while (br < code.size && !reader.eof())
+    if (code.flags & SF_LZ)
     {
-        ExecInstruction exec = {};
+        // Compressed code always has the runtime layout,
+        // so it expands straight into the instructions.
+        if (!(m_header.flags & HF_FIXED) || code.size % sizeof(ExecInstruction) != 0)
+        {
+            printf("misaligned instructions\n");
+            return PS_ERROR;
+        }
 
-        br += reader.read(&exec.op, 2);
-        br += reader.read(&exec.flags, 2);
-        br += reader.read(&sizes, 2);
+        m_ins.resize((size_t)(code.size / sizeof(ExecInstruction)));
+        if (expandSection(reader, (uint8_t*)m_ins.data(), (size_t)code.size) != PS_OK)
+        {
+            printf("failed to expand the code section\n");
+            return PS_ERROR;
+        }
 
-        if (exec.flags & IF_RIDX)
-            br += reader.read(&exec.index, 1);
+        m_code    = m_ins.data();
+        m_codeLen = m_ins.size();
+        m_lazy    = false;
+    }
+    else if (m_header.flags & HF_FIXED)
+    {
+        // The section already has the runtime layout,
+        // so it is used directly from the file.
+        size_t         start = reader.tell();
+        const uint8_t* base  = reader.ptr() + start;
+
+        if (code.size % sizeof(ExecInstruction) != 0 ||
+            code.size > reader.size() - start ||
+            (size_t)base % alignof(ExecInstruction) != 0)
+        {
+            printf("misaligned instructions\n");
+            return PS_ERROR;
+        }
 
-        for (i = 0; i < exec.argc && i < INS_ARG; ++i)
+        m_code    = (const ExecInstruction*)base;
+        m_codeLen = code.size / sizeof(ExecInstruction);
+        m_lazy    = false;
+
+        // File pages cannot be huge pages, so the
+        // code is copied out of the image instead.
+        if (m_pageMode == PM_HUGE)
         {
-            if (sizes & SizeFlags[i][0])
-            {
-                br += reader.read(&v8, 1);
-                exec.argv[i] = (uint64_t)v8;
-            }
-            else if (sizes & SizeFlags[i][1])
-            {
-                br += reader.read(&v16, 2);
-                exec.argv[i] = (uint64_t)v16;
-            }
-            else if (sizes & SizeFlags[i][2])
+            m_ins.assign(m_code, m_code + m_codeLen);
+            m_code = m_ins.data();
+            reader.discard(start, (size_t)code.size);
+        }
+    }
+    else if (code.size > reader.size() - m_codeStart)
+    {
+        printf("misaligned instructions\n");
+        return PS_ERROR;
+    }
+    else if (m_lazy)
+    {
+        // Every instruction starts out as OP_BEG, which
+        // decodes its function the first time it is executed.
+        // No instruction is shorter than MinInsSize bytes, which
+        // bounds how many the functions can claim to hold.
+        const TVMFunction& last = m_functions.back();
+        if (last.offset >= code.size ||
+            (uint64_t)last.start + last.count > code.size / MinInsSize)
+        {
+            printf("misaligned instructions\n");
+            return PS_ERROR;
+        }
+
+        m_ins.resize((size_t)last.start + last.count);
+        m_code    = m_ins.data();
+        m_codeLen = m_ins.size();
+    }
+    else if (decodeCode(reader, code) != PS_OK)
+        return PS_ERROR;
+
+    m_curinst = 0;
+    if (code.entry < m_codeLen)
+        m_curinst = code.entry;
+    m_startinst = m_curinst;
+    return PS_OK;
+}
+
+int Program::decodeCode(BlockReader& reader, const TVMSection& code)
+{
+    const uint8_t* base = reader.ptr() + reader.tell();
+    size_t         len  = (size_t)code.size;
+
+    // Without a function index, the boundaries cost an extra
+    // pass, which only pays off when there are threads to use.
+    bool serial = m_pool.size() <= 1 || len < LoadChunkSize * sizeof(ExecInstruction);
+    if (m_functions.empty() && serial)
+    {
+        size_t br = 0, nr;
+        while (br < len)
+        {
+            ExecInstruction exec;
+            if ((nr = decodeInstruction(base + br, len - br, exec)) == 0)
+                break;
+
+            m_ins.push_back(exec);
+            br += nr;
+        }
+
+        if (br != len)
+        {
+            printf("misaligned instructions\n");
+            return PS_ERROR;
+        }
+    }
+    else
+    {
+        // The boundaries are found first, so that every chunk
+        // can be decoded straight into its place in m_ins.
+        CodeChunks chunks;
+        if (findCodeChunks(base, len, chunks) != PS_OK)
+        {
+            printf("misaligned instructions\n");
+            return PS_ERROR;
+        }
+
+        m_ins.resize(chunks.back().first + chunks.back().count);
+
+        ExecInstruction* dest = m_ins.data();
+        m_pool.run(chunks.size(), [base, dest, &chunks](size_t i) {
+            if (!decodeChunk(base, chunks[i], dest))
+                chunks[i].error = "misaligned instructions";
+        });
+
+        CodeChunks::const_iterator it = chunks.begin();
+        for (; it != chunks.end(); ++it)
+        {
+            if (it->error != nullptr)
             {
-                br += reader.read(&v32, 4);
-                exec.argv[i] = (uint64_t)v32;
+                printf("%s\n", it->error);
+                return PS_ERROR;
             }
-            else
+        }
+    }
+
+    m_code    = m_ins.data();
+    m_codeLen = m_ins.size();
+    return PS_OK;
+}
+
+int Program::findCodeChunks(const uint8_t* base, size_t len, CodeChunks& chunks)
+{
+    CodeChunk chunk = {};
+    if (!m_functions.empty())
+    {
+        // The function index already holds the boundaries,
+        // so chunks are made from whole functions.
+        TVMFunctions::const_iterator it = m_functions.begin();
+        for (; it != m_functions.end(); ++it)
+        {
+            if (it->offset >= len)
+                return PS_ERROR;
+
+            if (chunk.count >= LoadChunkSize)
             {
-                br += reader.read(&exec.argv[i], 8);
+                chunk.end = it->offset;
+                chunks.push_back(chunk);
+
+                chunk        = {};
+                chunk.first  = it->start;
+                chunk.offset = it->offset;
             }
+            chunk.count += it->count;
         }
-
-        if (exec.flags & IF_SYMU)
+    }
+    else
+    {
+        size_t br = 0, nr;
+        while (br < len)
         {
-            if (findDynamic(exec) != PS_OK)
+            if (chunk.count == LoadChunkSize)
             {
-                printf("failed to locate symbol\n");
-                return PS_ERROR;
+                chunk.end = br;
+                chunks.push_back(chunk);
+
+                chunk        = {};
+                chunk.first  = chunks.back().first + LoadChunkSize;
+                chunk.offset = br;
             }
+
+            if ((nr = getInstructionSize(base + br, len - br)) == 0)
+                return PS_ERROR;
+
+            br += nr;
+            chunk.count++;
         }
+    }
 
-        if (testInstruction(exec))
-            m_ins.push_back(exec);
-        else
-            return PS_ERROR;
+    chunk.end = len;
+    chunks.push_back(chunk);
+    return PS_OK;
+}
+
+int Program::decodeFunction(size_t idx)
+{
+    const TVMFunction& func = m_functions.at(idx);
+
+    size_t end = m_codeSize;
+    if (idx + 1 < m_functions.size())
+        end = m_functions[idx + 1].offset;
+
+    const uint8_t* base = m_image.ptr() + m_codeStart;
+
+    size_t   br = func.offset, nr;
+    uint32_t i;
+    for (i = 0; i < func.count; ++i)
+    {
+        nr = decodeInstruction(base + br, end - br, m_ins[(size_t)func.start + i]);
+        if (nr == 0)
+            break;
+        br += nr;
     }
 
-    if (br != code.size)
+    if (i != func.count || br != end)
     {
         printf("misaligned instructions\n");
         return PS_ERROR;
     }
 
-    m_curinst = 0;
-    if (code.entry < m_ins.size())
-        m_curinst = code.entry;
-    m_startinst = m_curinst;
+    // cached images were verified when they were recorded
+    if (m_verified)
+        return PS_OK;
+    return verifyCode(func.start, func.count);
+}
+
+int Program::decodeFunctions(void)
+{
+    if (!m_lazy)
+        return PS_OK;
+
+    size_t i;
+    for (i = 0; i < m_functions.size(); ++i)
+    {
+        if (m_ins[m_functions[i].start].op == OP_BEG)
+        {
+            if (decodeFunction(i) != PS_OK)
+                return PS_ERROR;
+        }
+    }
+
+    m_lazy = false;
     return PS_OK;
 }
 
-int Program::findDynamic(ExecInstruction& ins)
+int Program::verifyCode(size_t first, size_t count)
 {
-    if (ins.argv[0] < m_strtablist.size())
+    size_t last = std::min(first + count, m_codeLen), i;
+
+    CodeChunks chunks;
+    for (i = first; i < last; i += LoadChunkSize)
     {
-        str_t name = m_strtablist.at((size_t)ins.argv[0]), look;
+        CodeChunk chunk = {};
+        chunk.first     = i;
+        chunk.count     = std::min(LoadChunkSize, last - i);
+        chunks.push_back(chunk);
+    }
 
-        // This needs to change to something better.
-        // It should be a predictable identifier to look up
-        // exported functions by the symbol itself rather
-        // than having to iterate over a table to find a named
-        // symbol
-        look = "__" + name;
+    // Checking an instruction only reads the program, so the
+    // chunks are checked in parallel. Each stops at its first
+    // failure and records the native calls that come before it.
+    m_pool.run(chunks.size(), [this, &chunks](size_t i) {
+        verifyChunk(chunks[i]);
+    });
 
-        SymbolMap::iterator it = m_symbols.find(name);
-        if (it == m_symbols.end())
-        {
-            Symbol search = nullptr;
+    // The native calls are resolved in order, up to the first
+    // failure, so the error is the same one a serial pass finds.
+    {
+        LoadTimer timer(m_profile, LP_RESOLVE);
 
-            DynamicLib::iterator it = m_dynlib.begin();
-            while (it != m_dynlib.end() && search == nullptr)
+        CodeChunks::const_iterator it = chunks.begin();
+        for (; it != chunks.end(); ++it)
+        {
+            std::vector<size_t>::const_iterator sym = it->symbols.begin();
+            for (; sym != it->symbols.end(); ++sym)
             {
-                LibHandle lib = (*it++);
-                LibSymbol sym = GetSymbolAddress(lib, look.c_str());
-
-                if (sym != nullptr)
+                if (findDynamic(m_code[*sym].argv[0]) != PS_OK)
                 {
-                    search          = (Symbol)sym;
-                    m_symbols[name] = search;
+                    printf("failed to locate symbol at instruction %zu\n", *sym);
+                    return PS_ERROR;
                 }
             }
 
-            ins.call = search;
+            if (it->error != nullptr)
+            {
+                printf("%s at instruction %zu\n", it->error, it->fail);
+                return PS_ERROR;
+            }
+        }
+    }
+    return verifyReadOnly(first, count);
+}
+
+void Program::verifyChunk(CodeChunk& chunk) const
+{
+    size_t i;
+    for (i = chunk.first; i < chunk.first + chunk.count; ++i)
+    {
+        const ExecInstruction& exec = m_code[i];
+        if (exec.flags & IF_SYMU)
+            chunk.symbols.push_back(i);
+
+        if ((chunk.error = checkInstruction(exec)) != nullptr)
+        {
+            chunk.fail = i;
+            break;
+        }
+    }
+}
+
+int Program::verifyReadOnly(size_t first, size_t count)
+{
+    if (m_rodata == nullptr)
+        return PS_OK;
+
+    size_t last = std::min(first + count, m_codeLen), i;
+    if (first >= last)
+        return PS_OK;
+
+    // Anything that can be branched to may be reached with
+    // different registers, so tracking restarts there.
+    std::vector<bool> targets(last - first, false);
+    for (i = first; i < last; ++i)
+    {
+        const ExecInstruction& exec = m_code[i];
+        if (exec.op >= OP_GTO && exec.op <= OP_JGE && exec.flags & IF_ADDR)
+        {
+            if (exec.argv[0] >= first && exec.argv[0] < last)
+                targets[(size_t)(exec.argv[0] - first)] = true;
+        }
+    }
+
+    // The registers that are known to hold a read-only address
+    uint16_t held = 0;
+    for (i = first; i < last; ++i)
+    {
+        const ExecInstruction& exec = m_code[i];
+        if (targets[i - first])
+            held = 0;
+
+        switch (exec.op)
+        {
+        case OP_ADRP:
+            if (isReadOnlyAddress(exec.argv[1]))
+                held |= 1 << exec.argv[0];
+            else
+                held &= ~(1 << exec.argv[0]);
+            break;
+        case OP_STRS:
+            if (exec.flags & IF_REG1 && held & (1 << exec.argv[1]))
+            {
+                printf("write to read-only data at instruction %zu\n", i);
+                return PS_ERROR;
+            }
+            break;
+        case OP_GTO:
+        case OP_RET:
+            held = 0;
+            break;
+        case OP_STR:
+            if (exec.flags & IF_REG1)
+                held &= ~(1 << exec.argv[1]);
+            held &= ~(1 << exec.argv[0]);
+            break;
+        case OP_CMP:
+        case OP_PRG:
+        case OP_PRI:
+        case OP_STP:
+        case OP_JMP:
+        case OP_JEQ:
+        case OP_JNE:
+        case OP_JLT:
+        case OP_JGT:
+        case OP_JLE:
+        case OP_JGE:
+            break;
+        default:
+            if (exec.flags & IF_REG0)
+                held &= ~(1 << exec.argv[0]);
+            break;
         }
-        else
-            ins.call = it->second;
     }
+    return PS_OK;
+}
+
+uint8_t* Program::getDataAddress(uint64_t addr) const
+{
+    if (isReadOnlyAddress(addr))
+        return (uint8_t*)m_rodata + (size_t)(addr - m_rodataAddr);
+    if (addr < m_dataTable.capacity())
+        return (uint8_t*)m_dataTable.ptr() + (size_t)addr;
+    return nullptr;
+}
+
+size_t Program::getDataExtent(const uint8_t* ptr) const
+{
+    if (isReadOnly(ptr))
+        return m_rodata + m_rodataLen - ptr;
+
+    const uint8_t* base = m_dataTable.ptr();
+    if (base != nullptr && ptr >= base && ptr < base + m_dataTable.capacity())
+        return base + m_dataTable.capacity() - ptr;
+    return 0;
+}
 
-    return ins.call != nullptr ? (int)PS_OK : (int)PS_ERROR;
+bool Program::isReadOnly(const uint8_t* ptr) const
+{
+    return m_rodata != nullptr && ptr >= m_rodata && ptr < m_rodata + m_rodataLen;
+}
+
+bool Program::isReadOnlyAddress(uint64_t addr) const
+{
+    return m_rodata != nullptr && addr >= m_rodataAddr && addr - m_rodataAddr < m_rodataLen;
+}
+
+const TVMFunction* Program::findFunction(uint64_t insp) const
+{
+    if (m_functions.empty() || insp >= m_codeLen)
+        return nullptr;
+
+    TVMFunctions::const_iterator it = std::upper_bound(
+        m_functions.begin(),
+        m_functions.end(),
+        insp,
+        [](uint64_t v, const TVMFunction& func) { return v < func.start; });
+
+    return &(*(it - 1));
+}
+
+bool Program::isFunctionStart(uint64_t insp) const
+{
+    const TVMFunction* func = findFunction(insp);
+    return func != nullptr && func->start == insp && *getFunctionName(*func) != 0;
+}
+
+const char* Program::getFunctionName(const TVMFunction& func) const
+{
+    if (func.name < m_functionNamesLen)
+        return m_functionNames + func.name;
+    return "";
+}
+
+int Program::findDynamic(uint64_t slot)
+{
+    if (slot >= m_calls.size())
+        return PS_ERROR;
+
+    // each slot only needs to be resolved once
+    if (m_calls[(size_t)slot] != nullptr)
+        return PS_OK;
+    return findImport((size_t)slot);
+}
+
+int Program::findImport(size_t slot)
+{
+    // The import names the library, so only
+    // that library's table has to be searched.
+    const TVMImport&       imp   = m_imports[slot];
+    const ModuleTable&     table = m_modules[imp.library];
+    const std::string_view name  = m_strtab.get(imp.name);
+
+    uint32_t i;
+    for (i = 0; i < table.count; ++i)
+    {
+        const SymbolTable& ent = table.symbols[i];
+        if (ent.callback != nullptr && name == ent.name)
+        {
+            m_calls[slot] = &ent;
+            return PS_OK;
+        }
+    }
+
+    str_t     look = "__" + str_t(name);
+    LibSymbol sym  = GetSymbolAddress(m_dynlib[imp.library], look.c_str());
+    if (sym == nullptr)
+        return PS_ERROR;
+
+    m_calls[slot] = &addDynamic(str_t(name), (Symbol)sym)->second;
+    return PS_OK;
+}
+
+SymbolMap::iterator Program::addDynamic(const str_t& name, Symbol callback)
+{
+    // no attributes are known, so assume the worst
+    SymbolMap::iterator it = m_symbols.insert({name, {}}).first;
+
+    it->second.name     = it->first.c_str();
+    it->second.callback = callback;
+    return it;
 }
 
 int Program::launch(void)
 {
-    if (m_ins.empty())
+    if (m_codeLen == 0)
         return PS_OK;
 
-    size_t                 tinst   = m_ins.size();
-    const ExecInstruction* basePtr = m_ins.data();
+    size_t                 tinst   = m_codeLen;
+    const ExecInstruction* basePtr = m_code;
     m_callStack.push(m_curinst);
 
     while (m_curinst < tinst && !m_exit)
     {
         const ExecInstruction& inst = basePtr[m_curinst++];
-        if (inst.op > OP_BEG && inst.op < OP_MAX)
+        if (inst.op < OP_MAX)
         {
             if (OPCodeTable[inst.op] != nullptr)
                 (this->*OPCodeTable[inst.op])(inst);
@@ -399,17 +1297,50 @@ void Program::forceExit(int returnCode)
     m_exit    = true;
 }
 
-Register* Program::clone(void)
+void Program::invoke(size_t slot)
 {
-    Register* reg = new Register[MAX_REG];
-    memcpy(reg, m_regi, MaxRegisterSize);
-    return reg;
-}
+    const SymbolTable& sym = *m_calls[slot];
+
+    // This does not guard against corrupting the cl
+    // pointer, but it allows access to the registers
+    // without passing the address of m_regi
+    // which can then be used to access internal
+    // class members. The registers that are not
+    // passed read as zero.
+    Registers cl = {};
+
+    uint16_t in = MaxRegisterMask, out = MaxRegisterMask;
+    if (sym.attributes & SA_WMSK)
+        out = sym.writes & MaxRegisterMask;
+
+    // writes may be partial, so the written
+    // registers need to be current as well.
+    if (sym.attributes & SA_RMSK)
+        in = (sym.reads | out) & MaxRegisterMask;
+
+    // A pure symbol that is called again with the same
+    // registers returns what it did the last time. The
+    // library is not trusted to have been checked by tcom.
+    SymbolMemo& memo = m_memo[slot];
+    bool        pure = (sym.attributes & SA_PURE) && (sym.attributes & SA_PREQ) == SA_PREQ;
+    if (pure && memo.valid && sameRegisters(memo.in, m_regi, in))
+    {
+        copyRegisters(m_regi, memo.out, out);
+        return;
+    }
 
-void Program::release(Register* reg)
-{
-    memcpy(m_regi, reg, MaxRegisterSize);
-    delete[] reg;
+    copyRegisters(cl, m_regi, in);
+    if (pure)
+        copyRegisters(memo.in, cl, in);
+
+    sym.callback((tvmregister_t)cl);
+    copyRegisters(m_regi, cl, out);
+
+    if (pure)
+    {
+        copyRegisters(memo.out, cl, out);
+        memo.valid = true;
+    }
 }
 
 void Program::derefRegister(const uint64_t& x0, const uint32_t& flags, uint8_t* ptr)
@@ -489,21 +1420,30 @@ void Program::handle_OP_MOV(const ExecInstruction& inst)
     }
 }
 
+void Program::handle_OP_BEG(const ExecInstruction&)
+{
+    // Verification rejects OP_BEG, so the only place it can
+    // be found is in a function that has not been decoded yet.
+    uint64_t           insp = m_curinst - 1;
+    const TVMFunction* func = m_lazy ? findFunction(insp) : nullptr;
+
+    if (func == nullptr ||
+        m_ins[func->start].op != OP_BEG ||
+        decodeFunction(func - m_functions.data()) != PS_OK)
+    {
+        printf("failed to decode the instruction at %llu\n", (unsigned long long)insp);
+        forceExit(-1);
+    }
+    else
+        m_curinst = insp;
+}
+
 void Program::handle_OP_CALL(const ExecInstruction& inst)
 {
     if (inst.flags & IF_SYMU)
     {
-        if (inst.call != nullptr)
-        {
-            // This does not guard against corrupting the cl
-            // pointer, but it allows access to the registers
-            // without passing the address of m_regi
-            // which can then be used to access internal
-            // class members.
-            Register* cl = clone();
-            inst.call((tvmregister_t)cl);
-            release(cl);
-        }
+        // verifyCode has resolved every slot
+        invoke((size_t)inst.argv[0]);
     }
     else if (inst.flags & IF_ADDR)
     {
@@ -807,11 +1747,9 @@ void Program::handle_OP_ADRP(const ExecInstruction& inst)
 {
     if (inst.flags & IF_REG0 && inst.flags & IF_ADRD)
     {
-        if (inst.argv[1] < m_dataTable.capacity())
-        {
-            uint8_t* base          = m_dataTable.ptr();
-            m_regi[inst.argv[0]].x = (size_t)(&base[inst.argv[1]]);
-        }
+        uint8_t* addr = getDataAddress(inst.argv[1]);
+        if (addr != nullptr)
+            m_regi[inst.argv[0]].x = (size_t)addr;
     }
 }
 
@@ -954,6 +1892,21 @@ void Program::handle_OP_LDR(const ExecInstruction& inst)
     }
 }
 
+// Returns the element size of ldrs and strs. The data section
+// packs each declaration at its natural width, so a w or l
+// register steps over 2 or 4 byte elements. An x register
+// still moves a single byte, as it always has.
+inline size_t getElementWidth(uint16_t flags)
+{
+    if (flags & IF_BTEW)
+        return 2;
+    if (flags & IF_BTEL)
+        return 4;
+    if (flags & IF_BTEQ)
+        return 8;
+    return 1;
+}
+
 void Program::handle_OP_LDRS(const ExecInstruction& inst)
 {
     if (inst.flags & IF_REG1)
@@ -970,9 +1923,19 @@ void Program::handle_OP_LDRS(const ExecInstruction& inst)
         {
             if (inst.index < MAX_REG)
             {
-                size_t i = (size_t)m_regi[inst.index].x;
-                if (i < m_dataTable.capacity())
-                    dreg.x = ptr[i];
+                size_t w = getElementWidth(inst.flags);
+                size_t i = (size_t)m_regi[inst.index].x * w;
+                if (i + w <= getDataExtent(ptr))
+                {
+                    if (w == 2)
+                        dreg.x = *(uint16_t*)(ptr + i);
+                    else if (w == 4)
+                        dreg.x = *(uint32_t*)(ptr + i);
+                    else if (w == 8)
+                        dreg.x = *(uint64_t*)(ptr + i);
+                    else
+                        dreg.x = ptr[i];
+                }
             }
         }
     }
@@ -992,9 +1955,24 @@ void Program::handle_OP_STRS(const ExecInstruction& inst)
         {
             if (inst.index < MAX_REG)
             {
-                size_t i = (size_t)m_regi[inst.index].x;
-                if (i < m_dataTable.capacity())
-                    ptr[i] = (uint8_t)dreg.x;
+                size_t w = getElementWidth(inst.flags);
+                size_t i = (size_t)m_regi[inst.index].x * w;
+                if (isReadOnly(ptr + i))
+                {
+                    printf("write to read-only data\n");
+                    forceExit(-1);
+                }
+                else if (i + w <= getDataExtent(ptr))
+                {
+                    if (w == 2)
+                        *(uint16_t*)(ptr + i) = (uint16_t)dreg.x;
+                    else if (w == 4)
+                        *(uint32_t*)(ptr + i) = (uint32_t)dreg.x;
+                    else if (w == 8)
+                        *(uint64_t*)(ptr + i) = dreg.x;
+                    else
+                        ptr[i] = (uint8_t)dreg.x;
+                }
             }
         }
     }
@@ -1031,14 +2009,11 @@ void Program::handle_OP_PRGI(const ExecInstruction& inst)
     }
 }
 
-bool Program::testInstruction(const ExecInstruction& exec)
+const char* Program::checkInstruction(const ExecInstruction& exec) const
 {
     bool pass = exec.op > OP_BEG && exec.op < OP_MAX;
     if (!pass)
-    {
-        printf("instruction boundary exceeded\n");
-        return false;
-    }
+        return "instruction boundary exceeded";
 
     switch (exec.op)
     {
@@ -1084,10 +2059,7 @@ bool Program::testInstruction(const ExecInstruction& exec)
     }
 
     if (!pass)
-    {
-        printf("invalid argument count\n");
-        return false;
-    }
+        return "invalid argument count";
 
     switch (exec.op)
     {
@@ -1102,10 +2074,14 @@ bool Program::testInstruction(const ExecInstruction& exec)
     case OP_JNE:
     case OP_JMP:
         pass = (exec.flags & IF_ADDR) != 0;
+        if (pass)
+            pass = exec.argv[0] < m_codeLen;
         break;
     case OP_GTO:
         pass = (exec.flags & IF_ADDR) != 0;
-        if (!pass)
+        if (pass)
+            pass = exec.argv[0] < m_codeLen;
+        else
             pass = (exec.flags & IF_SYMU) != 0;
         break;
     case OP_PRG:
@@ -1159,7 +2135,7 @@ bool Program::testInstruction(const ExecInstruction& exec)
             if (pass)
             {
                 if (exec.flags & IF_ADRD)
-                    pass = exec.argv[2] < m_dataTable.capacity();
+                    pass = getDataAddress(exec.argv[2]) != nullptr;
                 else if (exec.flags & IF_REG2)
                     pass = exec.argv[2] < MAX_REG;
             }
@@ -1170,15 +2146,12 @@ bool Program::testInstruction(const ExecInstruction& exec)
         break;
     }
     if (!pass)
-    {
-        printf("invalid instruction\n");
-        return false;
-    }
-    return true;
+        return "invalid instruction";
+    return nullptr;
 }
 
 const Program::Operation Program::OPCodeTable[] = {
-    nullptr,
+    &Program::handle_OP_BEG,
     &Program::handle_OP_RET,
     &Program::handle_OP_MOV,
     &Program::handle_OP_CALL,
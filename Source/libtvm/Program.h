@@ -28,7 +28,12 @@
 #include <vector>
 #include "BlockReader.h"
 #include "Declarations.h"
+#include "ImageCache.h"
+#include "LoadProfile.h"
 #include "MemoryStream.h"
+#include "StringTable.h"
+#include "ThreadPool.h"
+#include "SymbolUtils.h"
 
 class Program
 {
@@ -37,28 +42,54 @@ public:
     typedef Operation InstructionTable[OP_MAX - OP_BEG];
 
 protected:
-    ExecInstructions m_ins;
-    TVMHeader        m_header;
-    Registers        m_regi;
-    uint32_t         m_flags;
-    int32_t          m_return;
-    uint64_t         m_curinst;
-    uint64_t         m_startinst;
-    LabelMap         m_strtab;
-    strvec_t         m_strtablist;
-    ArrayStack       m_callStack;
-    str_t            m_modpath;
-    DynamicLib       m_dynlib;
-    SymbolMap        m_symbols;
-    MemoryStream     m_dataTable;
-    ArrayStack       m_stack;
-    bool             m_exit;
+    BlockReader            m_image;
+    ExecInstructions       m_ins;
+    const ExecInstruction* m_code;
+    size_t                 m_codeLen;
+    size_t                 m_codeSection;
+    size_t                 m_codeStart;
+    size_t                 m_codeSize;
+    TVMFunctions           m_functions;
+    const char*            m_functionNames;
+    size_t                 m_functionNamesLen;
+    bool                   m_lazy;
+    bool                   m_verified;
+    TVMHeader              m_header;
+    Registers              m_regi;
+    uint32_t               m_flags;
+    int32_t                m_return;
+    uint64_t               m_curinst;
+    uint64_t               m_startinst;
+    StringTable            m_strtab;
+    ArrayStack             m_callStack;
+    str_t                  m_modpath;
+    DynamicLib             m_dynlib;
+    SymbolMap              m_symbols;
+    SymbolSlots            m_calls;
+    SymbolMemos            m_memo;
+    TVMImports             m_imports;
+    ModuleTables           m_modules;
+    ImageCache             m_cache;
+    ImageCacheKey          m_key;
+    MemoryStream           m_dataTable;
+    const uint8_t*         m_rodata;
+    size_t                 m_rodataAddr;
+    size_t                 m_rodataLen;
+    ArrayStack             m_stack;
+    LoadProfile            m_profile;
+    ThreadPool             m_pool;
+    int                    m_pageMode;
+    bool                   m_exit;
 
     const static InstructionTable OPCodeTable;
     const static size_t           OPCodeTableSize;
 
-    int findDynamic(ExecInstruction& ins);
+    int findDynamic(uint64_t slot);
+    int findImport(size_t slot);
 
+    SymbolMap::iterator addDynamic(const str_t& name, Symbol callback);
+
+    void handle_OP_BEG(const ExecInstruction& inst);
     void handle_OP_RET(const ExecInstruction& inst);
     void handle_OP_MOV(const ExecInstruction& inst);
     void handle_OP_CALL(const ExecInstruction& inst);
@@ -99,20 +130,68 @@ protected:
         const uint64_t& val);
 
     void forceExit(int returnCode);
+    void invoke(size_t slot);
 
     int  loadStringTable(BlockReader& reader);
     int  loadSymbolTable(BlockReader& reader);
     int  loadDataTable(BlockReader& reader);
+    int  loadFunctionTable(BlockReader& reader);
     int  loadCode(BlockReader& reader);
-    bool testInstruction(const ExecInstruction& exec);
-
-    Register* clone(void);
-    void      release(Register*);
+    int  expandSection(BlockReader& reader, uint8_t* dest, size_t size);
+    int  decodeCode(BlockReader& reader, const TVMSection& code);
+    int  findCodeChunks(const uint8_t* base, size_t len, CodeChunks& chunks);
+    int  decodeFunction(size_t idx);
+    int  decodeFunctions(void);
+    int  verifyCode(size_t first, size_t count);
+    void verifyChunk(CodeChunk& chunk) const;
+    int  verifyReadOnly(size_t first, size_t count);
+    void loadModuleTable(LibHandle lib, const str_t& name);
+    int  bindCachedSlots(const ImageCacheSlots& slots);
+    int  storeCachedSlots(void);
+
+    // Returns why the instruction cannot be executed, or nullptr.
+    const char* checkInstruction(const ExecInstruction& exec) const;
+
+    // Returns the function that contains the instruction at insp.
+    const TVMFunction* findFunction(uint64_t insp) const;
+    const char*        getFunctionName(const TVMFunction& func) const;
+    bool               isFunctionStart(uint64_t insp) const;
+
+    // Maps a data address from the image to memory, or returns
+    // nullptr if it is outside of the data, BSS and read-only data.
+    uint8_t* getDataAddress(uint64_t addr) const;
+
+    // Returns the number of bytes that can be accessed from ptr,
+    // up to the end of the section that contains it.
+    size_t getDataExtent(const uint8_t* ptr) const;
+
+    bool isReadOnly(const uint8_t* ptr) const;
+    bool isReadOnlyAddress(uint64_t addr) const;
 
 public:
     Program(const str_t& modpath);
     ~Program();
 
+    // Enables the verified image cache in the supplied directory.
+    void setCacheDirectory(const str_t& dir);
+
+    // Records the time and allocations spent in each phase of load.
+    void setProfileLoad(bool enable);
+
+    // Sets the number of threads that decode and verify large
+    // images. Zero uses one per core, and one loads serially.
+    void setLoadThreads(unsigned threads);
+
+    // Places the instructions, data and stacks in 2 MB aligned
+    // blocks that the system is asked to back with huge pages.
+    // It needs to be called before load.
+    void setHugePages(bool enable);
+
+    const LoadProfile& getLoadProfile(void) const
+    {
+        return m_profile;
+    }
+
     int load(const char* fname);
     int launch(void);
 };
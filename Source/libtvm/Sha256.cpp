@@ -0,0 +1,186 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Sha256.h"
+#include <string.h>
+
+const uint32_t RoundConstants[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+inline uint32_t rotr(uint32_t v, int n)
+{
+    return (v >> n) | (v << (32 - n));
+}
+
+inline uint32_t load32(const uint8_t* p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+inline void store32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+Sha256::Sha256()
+{
+    reset();
+}
+
+void Sha256::reset(void)
+{
+    m_state[0] = 0x6A09E667;
+    m_state[1] = 0xBB67AE85;
+    m_state[2] = 0x3C6EF372;
+    m_state[3] = 0xA54FF53A;
+    m_state[4] = 0x510E527F;
+    m_state[5] = 0x9B05688C;
+    m_state[6] = 0x1F83D9AB;
+    m_state[7] = 0x5BE0CD19;
+    m_used     = 0;
+    m_length   = 0;
+}
+
+void Sha256::compress(const uint8_t* block)
+{
+    uint32_t w[64];
+    int      i;
+
+    for (i = 0; i < 16; ++i)
+        w[i] = load32(block + i * 4);
+
+    for (i = 16; i < 64; ++i)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i]        = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+
+    for (i = 0; i < 64; ++i)
+    {
+        uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + RoundConstants[i] + w[i];
+        uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        uint32_t mj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + mj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+void Sha256::update(const void* data, size_t len)
+{
+    const uint8_t* ptr = (const uint8_t*)data;
+    m_length += len;
+
+    if (m_used > 0)
+    {
+        size_t fill = 64 - m_used;
+        if (fill > len)
+            fill = len;
+
+        memcpy(m_block + m_used, ptr, fill);
+        m_used += fill;
+        ptr += fill;
+        len -= fill;
+
+        if (m_used < 64)
+            return;
+        compress(m_block);
+        m_used = 0;
+    }
+
+    // whole blocks are used in place
+    while (len >= 64)
+    {
+        compress(ptr);
+        ptr += 64;
+        len -= 64;
+    }
+
+    if (len > 0)
+    {
+        memcpy(m_block, ptr, len);
+        m_used = len;
+    }
+}
+
+void Sha256::finish(uint8_t digest[SHA256_SIZE])
+{
+    uint64_t bits = m_length * 8;
+
+    m_block[m_used++] = 0x80;
+    if (m_used > 56)
+    {
+        memset(m_block + m_used, 0, 64 - m_used);
+        compress(m_block);
+        m_used = 0;
+    }
+    memset(m_block + m_used, 0, 56 - m_used);
+
+    store32(m_block + 56, (uint32_t)(bits >> 32));
+    store32(m_block + 60, (uint32_t)bits);
+    compress(m_block);
+
+    int i;
+    for (i = 0; i < 8; ++i)
+        store32(digest + i * 4, m_state[i]);
+
+    reset();
+}
+
+void Sha256::digest(const void* data, size_t len, uint8_t digest[SHA256_SIZE])
+{
+    Sha256 sha;
+    sha.update(data, len);
+    sha.finish(digest);
+}
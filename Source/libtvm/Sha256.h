@@ -0,0 +1,52 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _Sha256_h_
+#define _Sha256_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_SIZE 32
+
+// FIPS 180-4 SHA-256. The image cache uses it so that a record
+// can only be found with the exact bytes it was verified with.
+class Sha256
+{
+private:
+    uint32_t m_state[8];
+    uint8_t  m_block[64];
+    size_t   m_used;
+    uint64_t m_length;
+
+    void compress(const uint8_t* block);
+
+public:
+    Sha256();
+
+    void reset(void);
+    void update(const void* data, size_t len);
+    void finish(uint8_t digest[SHA256_SIZE]);
+
+    static void digest(const void* data, size_t len, uint8_t digest[SHA256_SIZE]);
+};
+
+#endif  //_Sha256_h_
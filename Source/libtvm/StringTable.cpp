@@ -0,0 +1,205 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "StringTable.h"
+#include <string.h>
+#include <utility>
+#include "ImageCache.h"
+
+StringTable::StringTable() :
+    m_block(),
+    m_offsets(),
+    m_slots(),
+    m_index(nullptr),
+    m_data(nullptr),
+    m_count(0),
+    m_dataLen(0)
+{
+}
+
+StringTable::~StringTable()
+{
+}
+
+StringTable::StringTable(StringTable&& rhs) noexcept :
+    StringTable()
+{
+    *this = std::move(rhs);
+}
+
+StringTable& StringTable::operator=(StringTable&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        // Moving a vector keeps its storage, so the
+        // pointers stay valid for either kind of table.
+        m_block   = std::move(rhs.m_block);
+        m_offsets = std::move(rhs.m_offsets);
+        m_slots   = std::move(rhs.m_slots);
+        m_index   = rhs.m_index;
+        m_data    = rhs.m_data;
+        m_count   = rhs.m_count;
+        m_dataLen = rhs.m_dataLen;
+        rhs.clear();
+    }
+    return *this;
+}
+
+void StringTable::clear(void)
+{
+    m_block.clear();
+    m_offsets.clear();
+    m_slots.clear();
+
+    m_index   = nullptr;
+    m_data    = nullptr;
+    m_count   = 0;
+    m_dataLen = 0;
+}
+
+size_t StringTable::findSlot(const std::string_view& str, uint64_t hash) const
+{
+    // linear probing, the capacity is always a power of two
+    size_t mask = m_slots.size() - 1;
+    size_t i    = (size_t)hash & mask;
+
+    while (m_slots[i] != 0 && get(m_slots[i] - 1) != str)
+        i = (i + 1) & mask;
+    return i;
+}
+
+void StringTable::rehash(size_t capacity)
+{
+    m_slots.assign(capacity, 0);
+
+    uint32_t i;
+    for (i = 0; i < m_count; ++i)
+    {
+        std::string_view str = get(i);
+
+        size_t slot   = findSlot(str, ImageCache::hash(str.data(), str.size()));
+        m_slots[slot] = i + 1;
+    }
+}
+
+uint32_t StringTable::intern(const std::string_view& str)
+{
+    // A loaded table is read only until it is copied.
+    if (m_data != nullptr && m_data != m_block.data())
+    {
+        Index offsets(m_index, m_index + m_count);
+        m_offsets.swap(offsets);
+        m_block.assign(m_data, m_data + m_dataLen);
+        m_slots.clear();
+    }
+
+    if (m_slots.size() < ((size_t)m_count + 1) * 2)
+        rehash(m_slots.empty() ? 64 : m_slots.size() * 2);
+
+    uint64_t hash = ImageCache::hash(str.data(), str.size());
+    size_t   slot = findSlot(str, hash);
+    if (m_slots[slot] != 0)
+        return m_slots[slot] - 1;
+
+    m_offsets.push_back((uint32_t)m_block.size());
+    m_block.insert(m_block.end(), str.begin(), str.end());
+    m_block.push_back(0);
+
+    m_slots[slot] = ++m_count;
+    m_index       = m_offsets.data();
+    m_data        = m_block.data();
+    m_dataLen     = (uint32_t)m_block.size();
+    return m_count - 1;
+}
+
+int64_t StringTable::find(const std::string_view& str) const
+{
+    if (m_slots.empty())
+    {
+        // loaded tables are not hashed
+        uint32_t i;
+        for (i = 0; i < m_count; ++i)
+        {
+            if (get(i) == str)
+                return i;
+        }
+        return -1;
+    }
+
+    size_t slot = findSlot(str, ImageCache::hash(str.data(), str.size()));
+    if (m_slots[slot] != 0)
+        return m_slots[slot] - 1;
+    return -1;
+}
+
+int StringTable::load(const void* block, size_t len)
+{
+    clear();
+
+    const uint8_t* ptr   = (const uint8_t*)block;
+    uint32_t       count = 0;
+    if (len < sizeof(uint32_t))
+        return PS_ERROR;
+
+    memcpy(&count, ptr, sizeof(uint32_t));
+    ptr += sizeof(uint32_t);
+    len -= sizeof(uint32_t);
+
+    if ((size_t)count > len / sizeof(uint32_t))
+        return PS_ERROR;
+
+    size_t indexLen = (size_t)count * sizeof(uint32_t);
+    if ((size_t)ptr % alignof(uint32_t) == 0)
+        m_index = (const uint32_t*)ptr;
+    else
+    {
+        m_offsets.resize(count);
+        memcpy(m_offsets.data(), ptr, indexLen);
+        m_index = m_offsets.data();
+    }
+
+    m_data    = (const char*)ptr + indexLen;
+    m_dataLen = (uint32_t)(len - indexLen);
+    m_count   = count;
+
+    if (m_count == 0)
+        return m_dataLen == 0 ? PS_OK : PS_ERROR;
+
+    // Every string has to be terminated inside of the
+    // block, and only contain printable characters.
+    if (m_dataLen == 0 || m_data[m_dataLen - 1] != 0)
+        return PS_ERROR;
+
+    uint32_t i;
+    for (i = 0; i < m_dataLen; ++i)
+    {
+        uint8_t ch = (uint8_t)m_data[i];
+        if (ch != 0 && (ch < 32 || ch > 127))
+            return PS_ERROR;
+    }
+
+    for (i = 0; i < m_count; ++i)
+    {
+        if (m_index[i] >= m_dataLen)
+            return PS_ERROR;
+    }
+    return PS_OK;
+}
@@ -0,0 +1,126 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _StringTable_h_
+#define _StringTable_h_
+
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+#include "Declarations.h"
+
+// A list of unique strings that are stored back to back in one
+// block, with an index of where each one starts. This is also the
+// layout of an HF_STRIDX string section:
+//
+//      uint32_t count
+//      uint32_t offsets[count]
+//      char     strings[]       null terminated
+//
+// A loaded table references the image directly, so access
+// by index needs no allocations.
+class StringTable
+{
+private:
+    using Index = std::vector<uint32_t>;
+    using Block = std::vector<char>;
+
+    Block           m_block;
+    Index           m_offsets;
+    Index           m_slots;  // index + 1 into m_offsets, zero when empty
+    const uint32_t* m_index;
+    const char*     m_data;
+    uint32_t        m_count;
+    uint32_t        m_dataLen;
+
+    void   rehash(size_t capacity);
+    size_t findSlot(const std::string_view& str, uint64_t hash) const;
+
+public:
+    StringTable();
+    ~StringTable();
+
+    // A built table points into its own blocks,
+    // so it can be moved but not copied.
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+    StringTable(StringTable&& rhs) noexcept;
+    StringTable& operator=(StringTable&& rhs) noexcept;
+
+    void clear(void);
+
+    // Returns the index of str, adding it if it is not already present.
+    uint32_t intern(const std::string_view& str);
+
+    // Returns the index of str or -1 if it is not present.
+    int64_t find(const std::string_view& str) const;
+
+    // Points the table at a block laid out as an HF_STRIDX section.
+    // The block has to outlive the table.
+    int load(const void* block, size_t len);
+
+    std::string_view get(size_t idx) const
+    {
+        if (idx >= m_count)
+            return std::string_view();
+        return std::string_view(m_data + m_index[idx]);
+    }
+
+    const char* c_str(size_t idx) const
+    {
+        if (idx >= m_count)
+            return "";
+        return m_data + m_index[idx];
+    }
+
+    size_t size(void) const
+    {
+        return m_count;
+    }
+
+    bool empty(void) const
+    {
+        return m_count == 0;
+    }
+
+    const uint32_t* offsets(void) const
+    {
+        return m_index;
+    }
+
+    const char* data(void) const
+    {
+        return m_data;
+    }
+
+    size_t dataSize(void) const
+    {
+        return m_dataLen;
+    }
+
+    // The number of bytes needed to write the table as a section.
+    size_t byteSize(void) const
+    {
+        return sizeof(uint32_t) * ((size_t)m_count + 1) + m_dataLen;
+    }
+};
+
+#endif  //_StringTable_h_
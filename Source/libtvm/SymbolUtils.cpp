@@ -151,6 +151,28 @@ bool IsModulePresent(const str_t& modname, const str_t& moddir)
     return stat(absPath.c_str(), &_st) == 0;
 }
 
+uint64_t GetModuleStamp(const str_t& modname, const str_t& moddir)
+{
+    // Changes whenever the module is rebuilt or replaced.
+    str_t absPath;
+    MakeModulePath(absPath, modname, moddir);
+
+    struct stat _st;
+    if (stat(absPath.c_str(), &_st) != 0)
+        return 0;
+
+    uint64_t stamp = (uint64_t)_st.st_mtime;
+    stamp          = (stamp << 32) ^ (stamp >> 32);
+    stamp ^= (uint64_t)_st.st_size;
+#ifdef __linux__
+    stamp ^= (uint64_t)_st.st_mtim.tv_nsec << 16;
+#endif
+#ifndef _WIN32
+    stamp ^= (uint64_t)_st.st_ino * 0x9E3779B97F4A7C15ULL;
+#endif
+    return stamp;
+}
+
 void MakeModulePath(str_t& absPath, const str_t& modname, const str_t& moddir)
 {
     // Maintain control of the loaded module by allowing only absolute
@@ -34,6 +34,7 @@ extern void      UnloadSharedLibrary(LibHandle handle);
 extern LibSymbol GetSymbolAddress(LibHandle handle, const str_t& symname);
 extern void      FindModuleDirectory(str_t& dest);
 extern bool      IsModulePresent(const str_t& modname, const str_t& moddir);
+extern uint64_t  GetModuleStamp(const str_t& modname, const str_t& moddir);
 extern void      DisplayModulePath(void);
 
 #endif  //_SymbolUtils_h_
@@ -0,0 +1,417 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "TextScan.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TEXT_SCAN_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TEXT_SCAN_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+struct TextScanTable
+{
+    size_t (*skipWhiteSpace)(const uint8_t* src, size_t len);
+    size_t (*skipIdentifier)(const uint8_t* src, size_t len);
+    size_t (*findLineEnd)(const uint8_t* src, size_t len);
+    size_t (*skipNewLines)(const uint8_t* src, size_t len, int32_t& lines);
+};
+
+inline uint32_t countTrailingZeros(uint64_t v)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return (uint32_t)idx;
+#else
+    return (uint32_t)__builtin_ctzll(v);
+#endif
+}
+
+inline int32_t countBits(uint64_t v)
+{
+#ifdef _MSC_VER
+    return (int32_t)__popcnt64(v);
+#else
+    return (int32_t)__builtin_popcountll(v);
+#endif
+}
+
+inline bool isWhiteSpace(uint8_t ch)
+{
+    return ch == ' ' || ch == '\t';
+}
+
+inline bool isIdentifier(uint8_t ch)
+{
+    return (ch >= 'a' && ch <= 'z') ||
+           (ch >= 'A' && ch <= 'Z') ||
+           (ch >= '0' && ch <= '9') ||
+           ch == '_';
+}
+
+inline bool isNewLine(uint8_t ch)
+{
+    return ch == '\r' || ch == '\n';
+}
+
+inline size_t scalarSkipWhiteSpace(const uint8_t* src, size_t len)
+{
+    size_t i = 0;
+    while (i < len && isWhiteSpace(src[i]))
+        ++i;
+    return i;
+}
+
+inline size_t scalarSkipIdentifier(const uint8_t* src, size_t len)
+{
+    size_t i = 0;
+    while (i < len && isIdentifier(src[i]))
+        ++i;
+    return i;
+}
+
+inline size_t scalarFindLineEnd(const uint8_t* src, size_t len)
+{
+    size_t i = 0;
+    while (i < len && !isNewLine(src[i]) && src[i] != 0)
+        ++i;
+    return i;
+}
+
+inline size_t scalarSkipNewLines(const uint8_t* src, size_t len, int32_t& lines)
+{
+    size_t i = 0;
+    while (i < len && isNewLine(src[i]))
+    {
+        // the LF of a CRLF pair ends the line
+        if (src[i] == '\n' || i + 1 >= len || src[i + 1] != '\n')
+            lines++;
+        ++i;
+    }
+    return i;
+}
+
+const TextScanTable ScalarScan = {
+    scalarSkipWhiteSpace,
+    scalarSkipIdentifier,
+    scalarFindLineEnd,
+    scalarSkipNewLines,
+};
+
+#ifdef TEXT_SCAN_SSE2
+
+inline uint64_t sse2Equal(__m128i v, char ch)
+{
+    return (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(ch)));
+}
+
+inline uint64_t sse2Range(__m128i v, char lo, char hi)
+{
+    // characters above 127 are negative, so they are never in range
+    __m128i a = _mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1));
+    __m128i b = _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v);
+    return (uint64_t)_mm_movemask_epi8(_mm_and_si128(a, b));
+}
+
+inline size_t sse2SkipWhiteSpace(const uint8_t* src, size_t len)
+{
+    size_t i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i  v    = _mm_loadu_si128((const __m128i*)(src + i));
+        uint64_t rest = ~(sse2Equal(v, ' ') | sse2Equal(v, '\t')) & 0xFFFF;
+        if (rest != 0)
+            return i + countTrailingZeros(rest);
+    }
+    return i + scalarSkipWhiteSpace(src + i, len - i);
+}
+
+inline size_t sse2SkipIdentifier(const uint8_t* src, size_t len)
+{
+    size_t i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+
+        // setting bit 5 folds upper case onto lower case
+        __m128i  l    = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        uint64_t word = sse2Range(l, 'a', 'z') | sse2Range(v, '0', '9') | sse2Equal(v, '_');
+        uint64_t rest = ~word & 0xFFFF;
+        if (rest != 0)
+            return i + countTrailingZeros(rest);
+    }
+    return i + scalarSkipIdentifier(src + i, len - i);
+}
+
+inline size_t sse2FindLineEnd(const uint8_t* src, size_t len)
+{
+    size_t i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i  v   = _mm_loadu_si128((const __m128i*)(src + i));
+        uint64_t end = sse2Equal(v, '\n') | sse2Equal(v, '\r') | sse2Equal(v, 0);
+        if (end != 0)
+            return i + countTrailingZeros(end);
+    }
+    return i + scalarFindLineEnd(src + i, len - i);
+}
+
+inline size_t sse2SkipNewLines(const uint8_t* src, size_t len, int32_t& lines)
+{
+    size_t i;
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        __m128i  v  = _mm_loadu_si128((const __m128i*)(src + i));
+        uint64_t lf = sse2Equal(v, '\n');
+        uint64_t cr = sse2Equal(v, '\r');
+
+        uint64_t rest = ~(lf | cr) & 0xFFFF;
+        uint64_t run  = rest != 0 ? (rest & (0 - rest)) - 1 : 0xFFFF;
+
+        // a CR only ends a line when no LF follows it
+        if (i + 16 < len && src[i + 16] == '\n')
+            lf |= 0x10000;
+        lines += countBits(lf & run) + countBits(cr & ~(lf >> 1) & run);
+
+        if (rest != 0)
+            return i + countTrailingZeros(rest);
+    }
+    return i + scalarSkipNewLines(src + i, len - i, lines);
+}
+
+const TextScanTable Sse2Scan = {
+    sse2SkipWhiteSpace,
+    sse2SkipIdentifier,
+    sse2FindLineEnd,
+    sse2SkipNewLines,
+};
+
+#endif
+
+#ifdef TEXT_SCAN_AVX2
+
+TARGET_AVX2 inline uint64_t avx2Equal(__m256i v, char ch)
+{
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(ch)));
+}
+
+TARGET_AVX2 inline uint64_t avx2Range(__m256i v, char lo, char hi)
+{
+    __m256i a = _mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1));
+    __m256i b = _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(a, b));
+}
+
+TARGET_AVX2 inline size_t avx2SkipWhiteSpace(const uint8_t* src, size_t len)
+{
+    size_t i;
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        __m256i  v    = _mm256_loadu_si256((const __m256i*)(src + i));
+        uint64_t rest = ~(avx2Equal(v, ' ') | avx2Equal(v, '\t')) & 0xFFFFFFFF;
+        if (rest != 0)
+            return i + countTrailingZeros(rest);
+    }
+    return i + sse2SkipWhiteSpace(src + i, len - i);
+}
+
+TARGET_AVX2 inline size_t avx2SkipIdentifier(const uint8_t* src, size_t len)
+{
+    size_t i;
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        __m256i  v    = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i  l    = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        uint64_t word = avx2Range(l, 'a', 'z') | avx2Range(v, '0', '9') | avx2Equal(v, '_');
+        uint64_t rest = ~word & 0xFFFFFFFF;
+        if (rest != 0)
+            return i + countTrailingZeros(rest);
+    }
+    return i + sse2SkipIdentifier(src + i, len - i);
+}
+
+TARGET_AVX2 inline size_t avx2FindLineEnd(const uint8_t* src, size_t len)
+{
+    size_t i;
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        __m256i  v   = _mm256_loadu_si256((const __m256i*)(src + i));
+        uint64_t end = avx2Equal(v, '\n') | avx2Equal(v, '\r') | avx2Equal(v, 0);
+        if (end != 0)
+            return i + countTrailingZeros(end);
+    }
+    return i + sse2FindLineEnd(src + i, len - i);
+}
+
+TARGET_AVX2 inline size_t avx2SkipNewLines(const uint8_t* src, size_t len, int32_t& lines)
+{
+    size_t i;
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        __m256i  v  = _mm256_loadu_si256((const __m256i*)(src + i));
+        uint64_t lf = avx2Equal(v, '\n');
+        uint64_t cr = avx2Equal(v, '\r');
+
+        uint64_t rest = ~(lf | cr) & 0xFFFFFFFF;
+        uint64_t run  = rest != 0 ? (rest & (0 - rest)) - 1 : 0xFFFFFFFF;
+
+        if (i + 32 < len && src[i + 32] == '\n')
+            lf |= 0x100000000;
+        lines += countBits(lf & run) + countBits(cr & ~(lf >> 1) & run);
+
+        if (rest != 0)
+            return i + countTrailingZeros(rest);
+    }
+    return i + sse2SkipNewLines(src + i, len - i, lines);
+}
+
+const TextScanTable Avx2Scan = {
+    avx2SkipWhiteSpace,
+    avx2SkipIdentifier,
+    avx2FindLineEnd,
+    avx2SkipNewLines,
+};
+
+#endif
+
+inline int getSupportedMode(void)
+{
+#ifdef TEXT_SCAN_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return TSM_AVX2;
+#endif
+#ifdef TEXT_SCAN_SSE2
+    return TSM_SSE2;
+#else
+    return TSM_SCALAR;
+#endif
+}
+
+inline const TextScanTable* getTable(int mode)
+{
+    switch (mode)
+    {
+#ifdef TEXT_SCAN_AVX2
+    case TSM_AVX2:
+        return &Avx2Scan;
+#endif
+#ifdef TEXT_SCAN_SSE2
+    case TSM_SSE2:
+        return &Sse2Scan;
+#endif
+    default:
+        return &ScalarScan;
+    }
+}
+
+int                  ScanMode  = getSupportedMode();
+const TextScanTable* ScanTable = getTable(ScanMode);
+
+size_t SkipWhiteSpace(const uint8_t* src, size_t len)
+{
+    return ScanTable->skipWhiteSpace(src, len);
+}
+
+size_t SkipIdentifier(const uint8_t* src, size_t len)
+{
+    return ScanTable->skipIdentifier(src, len);
+}
+
+size_t FindLineEnd(const uint8_t* src, size_t len)
+{
+    return ScanTable->findLineEnd(src, len);
+}
+
+size_t SkipNewLines(const uint8_t* src, size_t len, int32_t& lines)
+{
+    return ScanTable->skipNewLines(src, len, lines);
+}
+
+inline uint32_t getDigitValue(uint8_t ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'z')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'Z')
+        return ch - 'A' + 10;
+    return 36;
+}
+
+uint64_t ScanInteger(const uint8_t* src, size_t len, int base)
+{
+    size_t i   = 0;
+    bool   neg = false;
+    if (i < len && (src[i] == '-' || src[i] == '+'))
+        neg = src[i++] == '-';
+
+    // strtoull skips an optional 0x in base 16
+    if (base == 16 && i + 2 < len && src[i] == '0' &&
+        (src[i + 1] == 'x' || src[i + 1] == 'X') &&
+        getDigitValue(src[i + 2]) < 16)
+        i += 2;
+
+    const uint64_t limit = UINT64_MAX / (uint64_t)base;
+
+    uint64_t v    = 0;
+    bool     over = false;
+    for (; i < len; ++i)
+    {
+        uint32_t d = getDigitValue(src[i]);
+        if (d >= (uint32_t)base)
+            break;
+
+        if (v > limit || v * base > UINT64_MAX - d)
+            over = true;
+        else
+            v = v * base + d;
+    }
+
+    if (over)
+        return UINT64_MAX;
+    return neg ? 0 - v : v;
+}
+
+int GetTextScanMode(void)
+{
+    return ScanMode;
+}
+
+void SetTextScanMode(int mode)
+{
+    int supported = getSupportedMode();
+    if (mode > supported)
+        mode = supported;
+    if (mode < TSM_SCALAR)
+        mode = TSM_SCALAR;
+
+    ScanMode  = mode;
+    ScanTable = getTable(mode);
+}
@@ -0,0 +1,68 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _TextScan_h_
+#define _TextScan_h_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Bulk character classification for the parser. Each function
+// looks at a run of characters starting at src, and never reads
+// past src + len. When the CPU supports it, 16 or 32 characters
+// are classified at a time.
+
+enum TextScanMode
+{
+    TSM_SCALAR,
+    TSM_SSE2,
+    TSM_AVX2,
+};
+
+// Returns the number of leading ' ' and '\t' characters.
+extern size_t SkipWhiteSpace(const uint8_t* src, size_t len);
+
+// Returns the number of leading [A-Za-z0-9_] characters.
+extern size_t SkipIdentifier(const uint8_t* src, size_t len);
+
+// Returns the index of the first '\r', '\n' or '\0', or len.
+extern size_t FindLineEnd(const uint8_t* src, size_t len);
+
+// Returns the number of leading '\r' and '\n' characters, and
+// adds the number of lines that they end to lines. CRLF ends one
+// line, and a lone CR or LF ends one line.
+extern size_t SkipNewLines(const uint8_t* src, size_t len, int32_t& lines);
+
+// Converts the digits in [src, src + len) to an integer in the
+// same way as strtoull, without needing a terminated copy. It stops
+// at the first character that is not a digit in base, and returns
+// UINT64_MAX if the value does not fit.
+extern uint64_t ScanInteger(const uint8_t* src, size_t len, int base);
+
+// The mode that is in use, which is the widest one
+// the CPU supports unless it has been set lower.
+extern int GetTextScanMode(void);
+
+// Limits the mode, mostly for testing. It is clamped
+// to what the CPU supports.
+extern void SetTextScanMode(int mode);
+
+#endif  //_TextScan_h_
@@ -0,0 +1,139 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+inline unsigned getThreadCount(unsigned threads)
+{
+    if (threads == 0)
+        return max(thread::hardware_concurrency(), 1u);
+    return threads;
+}
+
+ThreadPool::ThreadPool(unsigned threads) :
+    m_threads(getThreadCount(threads)),
+    m_task(nullptr),
+    m_count(0),
+    m_next(0),
+    m_job(0),
+    m_active(0),
+    m_stop(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::setThreads(unsigned threads)
+{
+    stop();
+    m_threads = getThreadCount(threads);
+}
+
+void ThreadPool::start(void)
+{
+    m_stop = false;
+    m_workers.reserve(m_threads - 1);
+
+    // The workers skip the jobs that ran before they started,
+    // or one left over from a stopped set would be run again.
+    unsigned i;
+    for (i = 1; i < m_threads; ++i)
+        m_workers.emplace_back(&ThreadPool::work, this, m_job);
+}
+
+void ThreadPool::stop(void)
+{
+    {
+        lock_guard<mutex> lock(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    vector<thread>::iterator it = m_workers.begin();
+    for (; it != m_workers.end(); ++it)
+        it->join();
+    m_workers.clear();
+}
+
+void ThreadPool::runTasks(void)
+{
+    size_t i;
+    while ((i = m_next.fetch_add(1, memory_order_relaxed)) < m_count)
+        (*m_task)(i);
+}
+
+void ThreadPool::work(uint64_t seen)
+{
+    for (;;)
+    {
+        {
+            unique_lock<mutex> lock(m_lock);
+            m_wake.wait(lock, [this, seen] { return m_stop || m_job != seen; });
+            if (m_stop)
+                return;
+            seen = m_job;
+        }
+
+        runTasks();
+
+        lock_guard<mutex> lock(m_lock);
+        if (--m_active == 0)
+            m_done.notify_one();
+    }
+}
+
+void ThreadPool::run(size_t count, const PoolTask& task)
+{
+    if (min<size_t>(m_threads, count) <= 1)
+    {
+        size_t i;
+        for (i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    if (m_workers.empty())
+        start();
+
+    {
+        lock_guard<mutex> lock(m_lock);
+        m_task   = &task;
+        m_count  = count;
+        m_active = m_workers.size();
+        m_next.store(0, memory_order_relaxed);
+        ++m_job;
+    }
+    m_wake.notify_all();
+
+    runTasks();
+
+    // Every worker has to leave the job before the
+    // next one can change the task it is reading.
+    unique_lock<mutex> lock(m_lock);
+    m_done.wait(lock, [this] { return m_active == 0; });
+    m_task = nullptr;
+}
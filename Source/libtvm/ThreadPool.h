@@ -0,0 +1,85 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _ThreadPool_h_
+#define _ThreadPool_h_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using PoolTask = std::function<void(size_t)>;
+
+// Runs a numbered set of independent tasks on a fixed number of
+// threads. The calling thread takes part, and run returns once
+// every task has finished. Tasks are handed out in order, but
+// they may complete in any order.
+//
+// The other threads are started by the first run that needs them
+// and wait for the next one until the pool is destroyed, so a run
+// does not pay for creating threads. A task must not call run on
+// the pool that is running it.
+class ThreadPool
+{
+private:
+    unsigned                 m_threads;
+    std::vector<std::thread> m_workers;
+    std::mutex               m_lock;
+    std::condition_variable  m_wake;
+    std::condition_variable  m_done;
+    const PoolTask*          m_task;
+    size_t                   m_count;
+    std::atomic<size_t>      m_next;
+    uint64_t                 m_job;
+    size_t                   m_active;
+    bool                     m_stop;
+
+    void start(void);
+    void stop(void);
+    void work(uint64_t seen);
+    void runTasks(void);
+
+public:
+    // Zero uses one thread per core.
+    ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Stops the current threads, and uses threads
+    // from the next run on. Zero uses one per core.
+    void setThreads(unsigned threads);
+
+    unsigned size(void) const
+    {
+        return m_threads;
+    }
+
+    void run(size_t count, const PoolTask& task);
+};
+
+#endif  //_ThreadPool_h_
@@ -51,10 +51,10 @@ SYM_API SYM_EXPORT void __getchar(tvmregister_t regi)
 }
 
 const SymbolTable stdlib[] = {
-    {"putchar", __putchar},
-    {"puts", __puts},
-    {"getchar", __getchar},
-    {nullptr, nullptr},
+    {"putchar", __putchar, SA_NMEM | SA_SAFE | SA_RMSK | SA_WMSK, SYM_REG(0), 0},
+    {"puts", __puts, SA_SAFE | SA_RMSK | SA_WMSK, SYM_REG(0), 0},
+    {"getchar", __getchar, SA_NMEM | SA_SAFE | SA_RMSK | SA_WMSK, 0, SYM_REG(0)},
+    {nullptr, nullptr, SA_NONE, 0, 0},
 };
 
 SYM_API SYM_EXPORT SymbolTable* std_init()
@@ -19,6 +19,7 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
+#include <string.h>
 #include <algorithm>
 #include <fstream>
 #include <iomanip>
@@ -27,9 +28,15 @@
 #include <vector>
 #include "BinaryWriter.h"
 #include "BlockReader.h"
+#include "CompileCache.h"
 #include "Declarations.h"
+#include "ImageCache.h"
+#include "ObjectFile.h"
+#include "Optimizer.h"
 #include "Parser.h"
+#include "Sha256.h"
 #include "SymbolUtils.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
@@ -41,10 +48,28 @@ struct ProgramInfo
     strvec_t files;
     strvec_t modules;
     bool     disableErrorFmt;
+    uint16_t formatFlags;
     string   modulePath;
+    unsigned threads;
+    bool     object;
+    string   cacheDir;
+    uint64_t cacheLimit;
+    bool     cacheLink;
+    bool     cacheStats;
+    bool     sync;
+    int      optimize;
+    int      peephole;
+    bool     peepholeRules;
+    bool     peepholeStats;
 };
 
+using Parsers = vector<Parser>;
+using Units   = vector<CompileUnit>;
+
 void usage(void);
+int  makeCacheKey(const ProgramInfo& ctx, const BinaryWriter& w, CompileCacheKey& key);
+int  printCacheStats(const ProgramInfo& ctx);
+int  parseRules(const char* list, int& rules);
 
 int main(int argc, char **argv)
 {
@@ -56,9 +81,38 @@ int main(int argc, char **argv)
 
     ProgramInfo ctx = {};
     int         i;
+
+    ctx.cacheLimit = CC_DEFAULT_LIMIT;
+
     for (i = 1; i < argc; ++i)
     {
-        if (argv[i][0] == '-')
+        if (strcmp(argv[i], "--cache-dir") == 0)
+        {
+            if (i + 1 < argc)
+                ctx.cacheDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache-size") == 0)
+        {
+            if (i + 1 < argc)
+                ctx.cacheLimit = strtoull(argv[++i], nullptr, 10) << 20;
+        }
+        else if (strcmp(argv[i], "--cache-link") == 0)
+            ctx.cacheLink = true;
+        else if (strcmp(argv[i], "--cache-stats") == 0)
+            ctx.cacheStats = true;
+        else if (strcmp(argv[i], "--fsync") == 0)
+            ctx.sync = true;
+        else if (strcmp(argv[i], "--peephole") == 0)
+        {
+            if (i + 1 < argc && parseRules(argv[++i], ctx.peephole) != PS_OK)
+                return PS_ERROR;
+            ctx.peepholeRules = true;
+        }
+        else if (strcmp(argv[i], "--peephole-stats") == 0)
+            ctx.peepholeStats = true;
+        else if (strcmp(argv[i], "--object") == 0)
+            ctx.object = true;
+        else if (argv[i][0] == '-')
         {
             switch (argv[i][1])
             {
@@ -81,6 +135,19 @@ int main(int argc, char **argv)
             case 'd':
                 ctx.disableErrorFmt = true;
                 break;
+            case 'f':
+                ctx.formatFlags |= HF_FIXED;
+                break;
+            case 'z':
+                ctx.formatFlags |= HF_LZ;
+                break;
+            case 'j':
+                if (i + 1 < argc)
+                    ctx.threads = (unsigned)atoi(argv[++i]);
+                break;
+            case 'O':
+                ctx.optimize = atoi(argv[i] + 2);
+                break;
             default:
                 break;
             }
@@ -89,6 +156,14 @@ int main(int argc, char **argv)
             ctx.files.push_back(argv[i]);
     }
 
+    if (ctx.cacheStats)
+        return printCacheStats(ctx);
+
+    // -O only picks the rules when they are not listed,
+    // so the order of the two options does not matter.
+    if (!ctx.peepholeRules)
+        ctx.peephole = ctx.optimize > 0 ? PR_ALL : 0;
+
     if (ctx.output.empty())
     {
         usage();
@@ -102,46 +177,269 @@ int main(int argc, char **argv)
     FindModuleDirectory(ctx.modulePath);
 
     BinaryWriter w(ctx.modulePath);
-    for (string file : ctx.files)
+    w.setFormatFlags(ctx.formatFlags);
+    w.setSync(ctx.sync);
+
+    // The modules are resolved before anything is parsed, since
+    // their symbols are part of the cache key. An object does
+    // not depend on them.
+    if (!ctx.object && w.resolve(ctx.modules) != PS_OK)
+        return PS_ERROR;
+
+    CompileCache    cache;
+    CompileCacheKey key = {};
+    if (!ctx.cacheDir.empty() && makeCacheKey(ctx, w, key) == PS_OK)
     {
-        Parser p;
-        if (ctx.disableErrorFmt)
-            p.disableErrorFormat(true);
+        cache.setDirectory(ctx.cacheDir);
+        cache.setLimit(ctx.cacheLimit);
+        cache.setLinking(ctx.cacheLink);
+
+        if (cache.fetch(key, ctx.output.c_str()) == PS_OK)
+        {
+            // The rules did not run, so there is nothing to count.
+            if (ctx.peepholeStats)
+                cout << "the output was found in the cache, no rules were run.\n";
+            return 0;
+        }
+    }
 
-        if (p.parse(file.c_str()) != PS_OK)
+    // Each file is parsed or loaded on its own thread. They are
+    // merged in the order they were given, so the output and the
+    // order of any errors do not depend on which one finishes first.
+    size_t      count = ctx.files.size();
+    Parsers     parsers(count);
+    Units       units(count);
+    vector<int> status(count, PS_OK);
+
+    for (i = 0; i < (int)count; ++i)
+    {
+        parsers[i].disableErrorFormat(ctx.disableErrorFmt);
+        parsers[i].bufferErrors(count > 1);
+    }
+
+    ThreadPool pool(ctx.threads);
+    pool.run(count, [&parsers, &units, &status, &ctx](size_t idx) {
+        const char* fname = ctx.files[idx].c_str();
+        if (ObjectFile::isObject(fname))
+            status[idx] = ObjectFile::load(units[idx], fname);
+        else
+        {
+            status[idx] = parsers[idx].parse(fname);
+            units[idx]  = std::move(parsers[idx].getUnit());
+        }
+    });
+
+    int rc = PS_OK;
+    for (i = 0; i < (int)count; ++i)
+    {
+        fputs(parsers[i].getErrors().c_str(), stdout);
+        if (status[i] != PS_OK)
+            rc = PS_ERROR;
+    }
+    if (rc != PS_OK)
+        return PS_ERROR;
+
+    parsers.clear();
+
+    Units::iterator it = units.begin();
+    for (; it != units.end(); ++it)
+    {
+        if (w.mergeUnit(*it) != PS_OK)
             return PS_ERROR;
+    }
+    units.clear();
+
+    // The output is replaced rather than written over,
+    // so a linked cache entry is never changed.
+    CompileCache::release(ctx.output.c_str());
+
+    // An object is written before anything is resolved,
+    // so it can be linked against other objects later.
+    CompileUnit& unit = w.getUnit();
+    if (ctx.object)
+    {
+        if (ObjectFile::save(unit, ctx.output.c_str()) != PS_OK)
+            return PS_ERROR;
+
+        // The rules run when the objects are linked.
+        if (ctx.peepholeStats)
+            cout << "an object is not optimized, no rules were run.\n";
+    }
+    else
+    {
+        // Calls between files are only known once they are merged.
+        Optimizer opt(unit.ins, unit.info);
 
-        if (w.mergeLabels(p.getLabels()) != PS_OK)
+        int64_t main = unit.names.find("main");
+        if (main > 0 && ctx.optimize > 0)
+            opt.unreferencedFunctions((uint32_t)main);
+
+        PeepholeCounts counts = {};
+        if (ctx.peephole != 0)
+            opt.peephole(ctx.peephole, counts);
+
+        if (ctx.peepholeStats && ctx.peephole == 0)
+            cout << "no peephole rules were selected.\n";
+        else if (ctx.peepholeStats)
+        {
+            for (i = 0; i < PR_MAX; ++i)
+            {
+                if (ctx.peephole & PR_BIT(i))
+                {
+                    cout << left << setw(9) << Optimizer::getRuleName(i);
+                    cout << counts.rule[i] << '\n';
+                }
+            }
+        }
+        opt.tailCalls();
+
+        if (w.open(ctx.output.c_str()) != PS_OK)
+            return PS_ERROR;
+        if (w.writeHeader() != PS_OK)
+            return PS_ERROR;
+        if (w.writeSections() != PS_OK)
             return PS_ERROR;
+        if (w.close() != PS_OK)
+            return PS_ERROR;
+    }
 
-        if (w.mergeDataDeclarations(p.getDataDeclarations()) != PS_OK)
+    cache.store(key, ctx.output.c_str());
+    return 0;
+}
+
+int makeCacheKey(const ProgramInfo& ctx, const BinaryWriter& w, CompileCacheKey& key)
+{
+    key = {};
+
+    // A hit is used without compiling anything, so the sources
+    // are keyed by a digest that cannot be made to collide. Each
+    // size goes in front of its bytes, so where one file ends
+    // and the next one starts is part of the key.
+    Sha256 source;
+
+    strvec_t::const_iterator file = ctx.files.begin();
+    for (; file != ctx.files.end(); ++file)
+    {
+        BlockReader reader(file->c_str());
+        if (!reader.ptr())
             return PS_ERROR;
 
-        w.mergeInstructions(p.getInstructions());
+        uint64_t size = reader.size();
+        source.update(&size, sizeof size);
+        source.update(reader.ptr(), reader.size());
+        key.size += size;
+    }
+    source.finish(key.source);
+
+    uint64_t config[5] = {
+        CC_VERSION,
+        TVM_VERSION,
+        OBJ_VERSION,
+        (uint64_t)ctx.peephole << 32 | (uint64_t)ctx.formatFlags << 1 | (ctx.object ? 1 : 0),
+        (uint64_t)ctx.optimize,
+    };
+    key.config = ImageCache::hash(config, sizeof config);
+    if (ctx.object)
+        return PS_OK;
+
+    strvec_t::const_iterator mod = ctx.modules.begin();
+    for (; mod != ctx.modules.end(); ++mod)
+        key.config = ImageCache::hash(mod->c_str(), mod->size() + 1, key.config);
 
-        // This has not been tested on multiple files yet.
-        break;
+    // The symbols are summed so that the order
+    // they are stored in does not matter.
+    uint64_t symbols = 0;
+
+    StringLookup::const_iterator sym = w.getSymbols().begin();
+    for (; sym != w.getSymbols().end(); ++sym)
+    {
+        uint64_t h = ImageCache::hash(sym->first.c_str(), sym->first.size() + 1);
+        symbols += ImageCache::hash(sym->second.c_str(), sym->second.size() + 1, h);
     }
 
-    if (w.resolve(ctx.modules) != PS_OK)
-        return PS_ERROR;
-    if (w.open(ctx.output.c_str()) != PS_OK)
-        return PS_ERROR;
-    if (w.writeHeader() != PS_OK)
-        return PS_ERROR;
-    if (w.writeSections() != PS_OK)
+    key.config = ImageCache::hash(&symbols, sizeof symbols, key.config);
+    return PS_OK;
+}
+
+int printCacheStats(const ProgramInfo& ctx)
+{
+    if (ctx.cacheDir.empty())
+    {
+        cout << "--cache-stats needs a --cache-dir.\n";
         return PS_ERROR;
+    }
+
+    CompileCache cache;
+    cache.setDirectory(ctx.cacheDir);
+
+    CompileCacheStats st;
+    cache.stats(st);
+
+    uint64_t lookups = st.hits + st.misses;
+    double   rate    = lookups ? 100.0 * (double)st.hits / (double)lookups : 0.0;
+
+    cout << "hits     " << st.hits << '\n';
+    cout << "misses   " << st.misses << '\n';
+    cout << "hit rate " << fixed << setprecision(1) << rate << "%\n";
+    cout << "evicted  " << st.evicted << '\n';
+    cout << "entries  " << st.entries << '\n';
+    cout << "size     " << st.bytes << " bytes\n";
     return 0;
 }
 
 void usage(void)
 {
-    cout << "tcom <options> <input file>\n\n";
+    cout << "tcom <options> <input files>\n\n";
     cout << "    options:\n\n";
     cout << "        -h show this message.\n";
     cout << "        -o output file.\n";
     cout << "        -l link library.\n";
     cout << "        -d disable full path when reporting errors.\n";
     cout << "        -m print the module path and exit.\n";
+    cout << "        -f write fixed width instructions that can be\n";
+    cout << "           executed in place.\n";
+    cout << "        -z compress the code and data sections. This\n";
+    cout << "           implies -f.\n";
+    cout << "        -j <n> parse with n threads. The default\n";
+    cout << "           is one per core.\n";
+    cout << "        --object write an object file (.tvo) that can be\n";
+    cout << "           linked with other objects and sources later.\n";
+    cout << "        --cache-dir <dir> reuse the output of earlier\n";
+    cout << "           compiles of the same inputs from dir.\n";
+    cout << "        --cache-size <MB> the size limit of the cache.\n";
+    cout << "           The default is 256.\n";
+    cout << "        --cache-link hard link outputs from the cache\n";
+    cout << "           rather than copying them.\n";
+    cout << "        --cache-stats print the cache statistics and exit.\n";
+    cout << "        --fsync flush the output file to the device before\n";
+    cout << "           exiting.\n";
+    cout << "        -O<n> optimize the instructions. -O1 runs every\n";
+    cout << "           peephole rule and leaves out functions that\n";
+    cout << "           cannot be reached from main. -O0 does neither.\n";
+    cout << "        --peephole <rule,...> run only the listed peephole\n";
+    cout << "           rules: move, identity, next, chain and compare.\n";
+    cout << "        --peephole-stats print the rewrites made by each rule.\n";
     cout << "\n";
 }
+
+int parseRules(const char* list, int& rules)
+{
+    rules = 0;
+
+    string       name;
+    stringstream ss(list);
+    while (getline(ss, name, ','))
+    {
+        if (name.empty())
+            continue;
+
+        int rule = Optimizer::findRule(name.c_str());
+        if (rule == -1)
+        {
+            cout << "unknown peephole rule '" << name << "'.\n";
+            return PS_ERROR;
+        }
+        rules |= PR_BIT(rule);
+    }
+    return PS_OK;
+}
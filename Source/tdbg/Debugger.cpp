@@ -29,7 +29,7 @@
 
 using namespace std;
 
-const DebugInstruction nop = {0, "nop", {0, 0, 0, {0, 0, 0}, 0, 0}};
+const DebugInstruction nop = {0, "nop", {0, 0, 0, 0, 0, {0, 0, 0}}};
 
 Debugger::Debugger(const str_t& mod, const str_t& file) :
     Program(mod),
@@ -66,6 +66,11 @@ int Debugger::debug(void)
     if (!m_console)
         return -1;
 
+    // everything is displayed up front, so
+    // nothing can be left to decode lazily
+    if (decodeFunctions() != PS_OK)
+        return -1;
+
     constructDebugInfo();
     calculateDisplayRects();
 
@@ -127,9 +132,9 @@ top:
 
 void Debugger::constructDebugInfo()
 {
-    m_debugInfo.reserve(m_ins.size());
+    m_debugInfo.reserve(m_codeLen);
 
-    ExecInstructions::iterator it = m_ins.begin(), end = m_ins.end();
+    const ExecInstruction* it = m_code, *end = m_code + m_codeLen;
     while (it != end)
     {
         const ExecInstruction& exec = (*it++);
@@ -141,6 +146,8 @@ void Debugger::constructDebugInfo()
     }
 
     m_ins.clear();
+    m_code    = nullptr;
+    m_codeLen = 0;
 }
 
 void Debugger::calculateDisplayRects(void)
@@ -255,7 +262,7 @@ void Debugger::stepOneInstruction(void)
         const DebugInstruction& dbg = m_debugInfo.at((size_t)m_curinst++);
         if (OPCodeTable[dbg.inst.op] != nullptr)
         {
-            switchOutput = (dbg.inst.op == OP_GTO && dbg.inst.call) || (dbg.inst.op >= OP_PRG);
+            switchOutput = (dbg.inst.op == OP_GTO && dbg.inst.flags & IF_SYMU) || (dbg.inst.op >= OP_PRG);
             if (switchOutput)
                 m_console->switchOutput(true);
 
@@ -395,9 +402,10 @@ void Debugger::displayStack(void)
 void Debugger::displayData(void)
 {
     uint8_t* data = m_dataTable.ptr();
-    if (!data ||
-        (m_dataTable.capacity() <= 0) ||
-        (m_curinst >= m_debugInfo.size()))
+    if (!data || m_dataTable.capacity() <= 0)
+        data = (uint8_t*)m_rodata;
+
+    if (!data || (m_curinst >= m_debugInfo.size()))
         return;
 
     if (m_baseAddr == 0)
@@ -423,7 +431,7 @@ void Debugger::displayData(void)
                 if (inst.index < MAX_REG)
                 {
                     size_t i = (size_t)m_regi[inst.index].x;
-                    if (i < m_dataTable.capacity())
+                    if (i < getDataExtent((uint8_t*)m_baseAddr))
                         m_lastAddr = i;
                 }
                 else
@@ -445,7 +453,7 @@ void Debugger::displayData(void)
         y = m_dataRect.y + 1;
 
         uint8_t* st = (uint8_t*)m_baseAddr;
-        uint8_t* en = data + m_dataTable.capacity();
+        uint8_t* en = st + getDataExtent(st);
 
         size_t sz = en - st;
         for (i = 0; i < sz && y < m_dataRect.bottom(); ++i)
@@ -585,8 +593,10 @@ str_t Debugger::getInstructionString(const ExecInstruction& inst)
     case OP_JGT:
     case OP_JLE:
     case OP_JGE:
-        if (inst.flags & IF_SYMU)
-            cw.writeCall();
+        if (inst.flags & IF_SYMU && inst.argv[0] < m_calls.size())
+            cw.writeCall(m_calls[(size_t)inst.argv[0]]);
+        else if (inst.op == OP_GTO && isFunctionStart(inst.argv[0]))
+            cw.writeLabel(getFunctionName(*findFunction(inst.argv[0])));
         else
             cw.writeValue(0, 4);
         break;
@@ -628,7 +638,7 @@ str_t Debugger::getInstructionString(const ExecInstruction& inst)
             {
                 cw.writeNext();
                 if (inst.flags & IF_ADRD)
-                    cw.writeAddrD(m_dataTable.addr(inst.argv[2]));
+                    cw.writeAddrD((size_t)getDataAddress(inst.argv[2]));
                 else
                     cw.writeValue(2);
             }
@@ -645,7 +655,7 @@ str_t Debugger::getInstructionString(const ExecInstruction& inst)
     case OP_ADRP:
         cw.writeRegister(0);
         cw.writeNext();
-        cw.writeAddrD(m_dataTable.addr(inst.argv[1]));
+        cw.writeAddrD((size_t)getDataAddress(inst.argv[1]));
         break;
     case OP_STP:
     case OP_LDP:
@@ -174,9 +174,17 @@ void InstructionWriter::writeRegIndex(void)
     m_os << hex;
 }
 
-void InstructionWriter::writeCall(void)
+void InstructionWriter::writeCall(const SymbolTable* call)
 {
-    m_os << "0x" << (size_t)m_inst.call;
+    if (call != nullptr && call->name != nullptr)
+        m_os << call->name;
+    else
+        m_os << "0x" << (size_t)call;
+}
+
+void InstructionWriter::writeLabel(const char* name)
+{
+    m_os << name;
 }
 
 void InstructionWriter::writeAddrD(size_t v)
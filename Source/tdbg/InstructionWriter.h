@@ -41,7 +41,8 @@ public:
     void  writeValue(int index, int width=-1);
     void  writeIndex(void);
     void  writeRegIndex(void);
-    void  writeCall(void);
+    void  writeCall(const SymbolTable* call);
+    void  writeLabel(const char* name);
     void  writeAddrD(size_t v);
     void  writeNext(void);
     void  openBrace(void);
@@ -19,12 +19,16 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
+#include <stdlib.h>
+#include <string.h>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <vector>
+#include "LoadProfile.h"
 #include "Program.h"
 #include "SymbolUtils.h"
 
@@ -32,11 +36,59 @@ using namespace std;
 
 void usage(void);
 
+// Every allocation made with new is reported
+// to the load profile before it is made.
+void* operator new(size_t size)
+{
+    LoadProfile::countAllocation(size);
+
+    void* ptr = malloc(size != 0 ? size : 1);
+    if (!ptr)
+        throw bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+enum LoadReport
+{
+    LR_NONE,
+    LR_TEXT,
+    LR_JSON,
+};
+
 struct ProgramInfo
 {
     bool   time;
+    int    load;
+    int    threads;
+    bool   hugePages;
     string file;
     string modulePath;
+    string cacheDir;
 };
 
 int main(int argc, char **argv)
@@ -54,11 +106,27 @@ int main(int argc, char **argv)
     {
         if (argv[i][0] != '-')
             ctx.file = argv[i];
+        else if (strcmp(argv[i], "--time-load") == 0)
+            ctx.load = LR_TEXT;
+        else if (strcmp(argv[i], "--time-load=json") == 0)
+            ctx.load = LR_JSON;
+        else if (strcmp(argv[i], "--hugepages") == 0)
+            ctx.hugePages = true;
         else
         {
             char ch = argv[i][1];
             if (ch == 't')
                 ctx.time = true;
+            else if (ch == 'c')
+            {
+                if (i + 1 < argc)
+                    ctx.cacheDir = argv[++i];
+            }
+            else if (ch == 'j')
+            {
+                if (i + 1 < argc)
+                    ctx.threads = atoi(argv[++i]);
+            }
             else if (ch == 'm')
             {
                 DisplayModulePath();
@@ -82,7 +150,23 @@ int main(int argc, char **argv)
     FindModuleDirectory(ctx.modulePath);
 
     Program prog(ctx.modulePath);
-    if (prog.load(ctx.file.c_str()) != PS_OK)
+    if (!ctx.cacheDir.empty())
+        prog.setCacheDirectory(ctx.cacheDir);
+
+    if (ctx.hugePages)
+        prog.setHugePages(true);
+    if (ctx.threads > 0)
+        prog.setLoadThreads((unsigned)ctx.threads);
+    if (ctx.load != LR_NONE)
+        prog.setProfileLoad(true);
+
+    int loaded = prog.load(ctx.file.c_str());
+    if (ctx.load == LR_TEXT)
+        prog.getLoadProfile().print(ctx.file.c_str());
+    else if (ctx.load == LR_JSON)
+        prog.getLoadProfile().printJson(ctx.file.c_str());
+
+    if (loaded != PS_OK)
         return 1;
 
     int rc = 0;
@@ -103,6 +187,12 @@ void usage(void)
     cout << "    options:\n\n";
     cout << "        -h display this message.\n";
     cout << "        -t display execution time.\n";
+    cout << "        --time-load[=json] display the time and allocations\n";
+    cout << "            of each phase of loading the program.\n";
     cout << "        -m print the module path and exit.\n";
+    cout << "        -c <dir> cache verified images in dir.\n";
+    cout << "        -j <n> decode and verify with n threads.\n";
+    cout << "        --hugepages back the code, data and stacks\n";
+    cout << "            with huge pages when the system allows it.\n";
     cout << "\n";
 }
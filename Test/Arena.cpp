@@ -0,0 +1,65 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Arena.h"
+#include <string.h>
+#include <utility>
+#include "Catch2.h"
+
+TEST_CASE("Arena1")
+{
+    Arena arena(64);
+
+    // small allocations share a block and keep their alignment
+    uint8_t* a = (uint8_t*)arena.allocate(3, 1);
+    uint8_t* b = (uint8_t*)arena.allocate(8, 8);
+    EXPECT_EQ(((uintptr_t)b) % 8, 0);
+    EXPECT_GE(b, a + 3);
+    EXPECT_EQ(arena.bytes(), 11);
+
+    // a larger one gets a block of its own
+    uint8_t* c = (uint8_t*)arena.allocate(1000);
+    memset(c, 1, 1000);
+    EXPECT_EQ(arena.bytes(), 1011);
+
+    std::string_view s = arena.store("abc\n");
+    EXPECT_EQ(s, "abc\n");
+    EXPECT_EQ(s.data()[s.size()], 0);
+
+    std::string_view e = arena.store(std::string_view());
+    EXPECT_TRUE(e.empty());
+    EXPECT_EQ(e.data()[0], 0);
+
+    // merging and moving keep the blocks where they are
+    Arena other(64);
+    other.merge(arena);
+    EXPECT_EQ(arena.bytes(), 0);
+    EXPECT_EQ(other.bytes(), 1017);
+
+    Arena moved(std::move(other));
+    EXPECT_EQ(other.bytes(), 0);
+    EXPECT_EQ(moved.bytes(), 1017);
+    EXPECT_EQ(s, "abc\n");
+    EXPECT_EQ(c[999], 1);
+
+    moved.clear();
+    EXPECT_EQ(moved.bytes(), 0);
+}
@@ -0,0 +1,113 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "BinaryWriter.h"
+#include <stdio.h>
+#include <string.h>
+#include "BlockReader.h"
+#include "Catch2.h"
+#include "Parser.h"
+
+TEST_CASE("BinaryWriter1")
+{
+    const std::string TestFile = std::string(TestDirectory) + "/Exec/Rodata.asm";
+
+    const uint16_t formats[] = {0, HF_FIXED, HF_LZ};
+
+    for (uint16_t flags : formats)
+    {
+        Parser p, q;
+        EXPECT_EQ(p.parse(TestFile.c_str()), PS_OK);
+        EXPECT_EQ(q.parse(TestFile.c_str()), PS_OK);
+
+        strvec_t     modules;
+        BinaryWriter w(""), f("");
+        w.setFormatFlags(flags);
+        EXPECT_EQ(w.mergeUnit(p.getUnit()), PS_OK);
+        EXPECT_EQ(w.resolve(modules), PS_OK);
+
+        // without a file the image is built in memory
+        EXPECT_EQ(w.writeHeader(), PS_OK);
+        EXPECT_EQ(w.writeSections(), PS_OK);
+
+        const MemoryStream& image = w.getImage();
+        EXPECT_GT(image.size(), sizeof(TVMHeader));
+        EXPECT_EQ(image.size() % 16, 0);
+        EXPECT_EQ(image.ptr()[0], 'T');
+        EXPECT_EQ(image.ptr()[1], 'V');
+        EXPECT_EQ(w.close(), PS_OK);
+
+        // with one, it is written in place, and the
+        // file holds the same bytes
+        f.setFormatFlags(flags);
+        EXPECT_EQ(f.mergeUnit(q.getUnit()), PS_OK);
+        EXPECT_EQ(f.resolve(modules), PS_OK);
+        EXPECT_EQ(f.open("BinaryWriter1.tvm"), PS_OK);
+        EXPECT_EQ(f.writeHeader(), PS_OK);
+        EXPECT_EQ(f.writeSections(), PS_OK);
+        EXPECT_EQ(f.getImage().size(), 0);
+        EXPECT_EQ(f.close(), PS_OK);
+
+        BlockReader r("BinaryWriter1.tvm");
+        EXPECT_EQ(r.size(), image.size());
+        EXPECT_EQ(memcmp(r.ptr(), image.ptr(), image.size()), 0);
+    }
+    remove("BinaryWriter1.tvm");
+}
+
+void testSymbol(tvmregister_t)
+{
+}
+
+TEST_CASE("BinaryWriter2")
+{
+    const uint16_t pure = SA_PURE | SA_NMEM | SA_RMSK | SA_WMSK;
+
+    SymbolTable sym = {"test", testSymbol, SA_NONE, 0, 0};
+    EXPECT_TRUE(BinaryWriter::isValidSymbol(sym));
+
+    sym.attributes = SA_NMEM | SA_SAFE;
+    EXPECT_TRUE(BinaryWriter::isValidSymbol(sym));
+
+    // a pure symbol has to name every register it uses
+    sym.attributes = pure;
+    sym.reads      = SYM_REG(0) | SYM_REG(1);
+    sym.writes     = SYM_REG(0);
+    EXPECT_TRUE(BinaryWriter::isValidSymbol(sym));
+
+    sym.attributes = pure & ~SA_NMEM;
+    EXPECT_FALSE(BinaryWriter::isValidSymbol(sym));
+    sym.attributes = pure & ~SA_WMSK;
+    EXPECT_FALSE(BinaryWriter::isValidSymbol(sym));
+
+    // x9 is not passed to a symbol, and unknown bits are rejected
+    sym.attributes = pure;
+    sym.writes     = SYM_REG(MAX_REG - 1);
+    EXPECT_FALSE(BinaryWriter::isValidSymbol(sym));
+
+    sym.writes     = SYM_REG(0);
+    sym.attributes = pure | (SA_MASK + 1);
+    EXPECT_FALSE(BinaryWriter::isValidSymbol(sym));
+
+    sym.attributes = SA_NONE;
+    sym.callback   = nullptr;
+    EXPECT_FALSE(BinaryWriter::isValidSymbol(sym));
+}
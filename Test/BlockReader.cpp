@@ -90,3 +90,75 @@ TEST_CASE("BlockReader2")
 
     EXPECT_EQ(r.tell(), r.size());
 }
+
+TEST_CASE("BlockReader3")
+{
+    BlockReader a, b;
+    a.open(KeywordsFile.c_str(), BRM_BUFFERED);
+    b.open(KeywordsFile.c_str(), BRM_MAPPED);
+
+    EXPECT_FALSE(a.mapped());
+#ifndef _WIN32
+    EXPECT_TRUE(b.mapped());
+#endif
+    EXPECT_FALSE(a.eof());
+    EXPECT_FALSE(b.eof());
+    EXPECT_EQ(a.size(), b.size());
+    EXPECT_EQ(memcmp(a.ptr(), b.ptr(), a.size()), 0);
+
+    while (!a.eof() && !b.eof())
+    {
+        EXPECT_EQ(a.current(), b.current());
+        EXPECT_EQ(a.next(), b.next());
+    }
+
+    EXPECT_TRUE(a.eof());
+    EXPECT_TRUE(b.eof());
+    EXPECT_EQ(a.next(), 0);
+    EXPECT_EQ(b.next(), 0);
+
+    // reopening releases the old block
+    b.open(KeywordsFile.c_str(), BRM_BUFFERED);
+    EXPECT_FALSE(b.mapped());
+    EXPECT_EQ(b.tell(), 0);
+    EXPECT_EQ(b.size(), a.size());
+
+    b.open("not a file", BRM_MAPPED);
+    EXPECT_FALSE(b.mapped());
+    EXPECT_TRUE(b.eof());
+    EXPECT_EQ(b.size(), 0);
+}
+
+TEST_CASE("BlockReader4")
+{
+    // discarded pages are read back from the file
+    const char *TempFile = "BlockReader4.tmp";
+
+    size_t   size = 0x10000 * 3 + 17, i;
+    uint8_t *tmp  = new uint8_t[size];
+    for (i = 0; i < size; ++i)
+        tmp[i] = (uint8_t)(i * 7);
+
+    FILE *fp = fopen(TempFile, "wb");
+    EXPECT_TRUE(fp != nullptr);
+    fwrite(tmp, 1, size, fp);
+    fclose(fp);
+
+    {
+        BlockReader a, b;
+        a.open(TempFile, BRM_MAPPED);
+        b.open(TempFile, BRM_BUFFERED);
+        EXPECT_EQ(a.size(), size);
+
+        a.discard(3, 0x10000 * 2);
+        a.discard(0, size);
+        b.discard(0, size);
+        a.discard(size, 100);
+
+        EXPECT_EQ(memcmp(a.ptr(), tmp, size), 0);
+        EXPECT_EQ(memcmp(b.ptr(), tmp, size), 0);
+    }
+
+    remove(TempFile);
+    delete[] tmp;
+}
@@ -0,0 +1,121 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "CompileCache.h"
+#include <stdio.h>
+#include <filesystem>
+#include "BlockReader.h"
+#include "Catch2.h"
+
+const std::string CacheDir = "CompileCache1";
+
+void writeTestFile(const char* fname, const char* text)
+{
+    FILE* fp = fopen(fname, "wb");
+    EXPECT_NE(fp, nullptr);
+    fputs(text, fp);
+    fclose(fp);
+}
+
+TEST_CASE("CompileCache1")
+{
+    std::error_code ec;
+    std::filesystem::remove_all(CacheDir, ec);
+
+    CompileCache    cache;
+    CompileCacheKey key = {};
+    key.source[0]       = 1;
+    key.size            = 2;
+    key.config          = 3;
+    EXPECT_FALSE(cache.enabled());
+    EXPECT_EQ(cache.fetch(key, "CompileCache1.out"), PS_UNDEFINED);
+
+    cache.setDirectory(CacheDir);
+    EXPECT_TRUE(cache.enabled());
+    EXPECT_EQ(cache.fetch(key, "CompileCache1.out"), PS_UNDEFINED);
+
+    writeTestFile("CompileCache1.in", "cached output");
+    EXPECT_EQ(cache.store(key, "CompileCache1.in"), PS_OK);
+
+    // any part of the key has to match
+    CompileCacheKey other = key;
+    other.config          = 4;
+    EXPECT_EQ(cache.fetch(other, "CompileCache1.out"), PS_UNDEFINED);
+    EXPECT_EQ(cache.fetch(key, "CompileCache1.out"), PS_OK);
+
+    BlockReader r("CompileCache1.out");
+    EXPECT_EQ(r.size(), 13);
+    EXPECT_EQ(std::string((const char*)r.ptr(), r.size()), "cached output");
+
+    CompileCacheStats st;
+    EXPECT_EQ(cache.stats(st), PS_OK);
+    EXPECT_EQ(st.hits, 1);
+    EXPECT_EQ(st.misses, 2);
+    EXPECT_EQ(st.entries, 1);
+    EXPECT_EQ(st.bytes, 13);
+    EXPECT_EQ(st.evicted, 0);
+
+    remove("CompileCache1.in");
+    remove("CompileCache1.out");
+}
+
+TEST_CASE("CompileCache2")
+{
+    std::error_code ec;
+    std::filesystem::remove_all(CacheDir, ec);
+
+    CompileCache cache;
+    cache.setDirectory(CacheDir);
+    cache.setLimit(20);
+
+    writeTestFile("CompileCache2.in", "0123456789");
+
+    CompileCacheKey key = {};
+    for (key.source[0] = 0; key.source[0] < 3; ++key.source[0])
+        EXPECT_EQ(cache.store(key, "CompileCache2.in"), PS_OK);
+
+    // only two of the entries fit under the limit
+    CompileCacheStats st;
+    EXPECT_EQ(cache.stats(st), PS_OK);
+    EXPECT_EQ(st.entries, 2);
+    EXPECT_EQ(st.bytes, 20);
+    EXPECT_EQ(st.evicted, 1);
+
+    // a hit replaces whatever was at the output
+    writeTestFile("CompileCache2.out", "stale");
+    cache.setLinking(true);
+
+    int hits = 0;
+    for (key.source[0] = 0; key.source[0] < 3; ++key.source[0])
+        hits += cache.fetch(key, "CompileCache2.out") == PS_OK ? 1 : 0;
+    EXPECT_EQ(hits, 2);
+
+    BlockReader r("CompileCache2.out");
+    EXPECT_EQ(r.size(), 10);
+
+    CompileCache::release("CompileCache2.out");
+    EXPECT_FALSE(std::filesystem::exists("CompileCache2.out"));
+    EXPECT_EQ(cache.stats(st), PS_OK);
+    EXPECT_EQ(st.entries, 2);
+
+    remove("CompileCache2.in");
+    std::filesystem::remove_all(CacheDir, ec);
+}
@@ -0,0 +1,4 @@
+main:
+    mov x0, 0
+    b   end
+end:
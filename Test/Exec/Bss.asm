@@ -0,0 +1,25 @@
+; ----------------------------------------------------
+                    .data
+; ----------------------------------------------------
+head:      .asciz  "bss"
+scratch:   .zero   67108864
+tail:      .zero   16
+; ----------------------------------------------------
+                    .text
+; ----------------------------------------------------
+main:
+    adrp    x8, head
+    adrp    x7, scratch
+    mov     x5, 67108863
+    mov     x4, 42
+    strs    x4, [x7, x5]
+    ldrs    x0, [x7, x5]
+    prg     x0
+    adrp    x7, tail
+    mov     x5, 0
+    ldrs    x0, [x7, x5]
+    prg     x0
+    ldrs    x0, [x8, x5]
+    prg     x0
+    mov     w0, 0
+    ret
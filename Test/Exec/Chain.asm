@@ -0,0 +1,89 @@
+; A chain of twenty b instructions, and a loop of
+; them after the return that is never run.
+main:
+    mov  x0, 67
+    bl   putchar
+    mov  x0, 10
+    bl   putchar
+    b    hop1
+hop1:
+    b    hop2
+hop2:
+    b    hop3
+hop3:
+    b    hop4
+hop4:
+    b    hop5
+hop5:
+    b    hop6
+hop6:
+    b    hop7
+hop7:
+    b    hop8
+hop8:
+    b    hop9
+hop9:
+    b    hop10
+hop10:
+    b    hop11
+hop11:
+    b    hop12
+hop12:
+    b    hop13
+hop13:
+    b    hop14
+hop14:
+    b    hop15
+hop15:
+    b    hop16
+hop16:
+    b    hop17
+hop17:
+    b    hop18
+hop18:
+    b    hop19
+hop19:
+    b    hop20
+hop20:
+    mov  x0, 0
+    ret
+spin1:
+    b    spin2
+spin2:
+    b    spin3
+spin3:
+    b    spin4
+spin4:
+    b    spin5
+spin5:
+    b    spin6
+spin6:
+    b    spin7
+spin7:
+    b    spin8
+spin8:
+    b    spin9
+spin9:
+    b    spin10
+spin10:
+    b    spin11
+spin11:
+    b    spin12
+spin12:
+    b    spin13
+spin13:
+    b    spin14
+spin14:
+    b    spin15
+spin15:
+    b    spin16
+spin16:
+    b    spin17
+spin17:
+    b    spin18
+spin18:
+    b    spin19
+spin19:
+    b    spin20
+spin20:
+    b    spin1
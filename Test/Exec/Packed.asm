@@ -0,0 +1,40 @@
+; ----------------------------------------------------
+                    .data
+; ----------------------------------------------------
+bytes:     .byte   1, 2, 3
+words:     .word   0x100, 0x200, 0x300
+longs:     .long   70000, 80000
+quads:     .quad   5, 0x123456789
+; ----------------------------------------------------
+                    .text
+; ----------------------------------------------------
+main:
+    adrp    x8, bytes
+    mov     x5, 2
+    ldrs    b0, [x8, x5]
+    prg     x0
+    adrp    x8, words
+    mov     x5, 1
+    ldrs    w0, [x8, x5]
+    prg     x0
+    mov     x4, 0x400
+    mov     x5, 2
+    strs    w4, [x8, x5]
+    ldrs    w0, [x8, x5]
+    prg     x0
+    adrp    x8, longs
+    mov     x5, 1
+    ldrs    l0, [x8, x5]
+    prg     x0
+    adrp    x9, quads
+    add     x0, x9, quads
+    prg     x0
+    mov     x5, 1
+    ldrs    q0, [x9, x5]
+    prg     x0
+    mov     x4, 0x987654321
+    strs    q4, [x9, x5]
+    ldrs    q0, [x9, x5]
+    prg     x0
+    mov     w0, 0
+    ret
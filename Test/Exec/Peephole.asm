@@ -0,0 +1,37 @@
+; Each of the tcom -O1 peephole rules has something to
+; rewrite here, and the output is the same either way.
+main:
+    mov  x1, 65
+    mov  x1, x1
+    add  x1, 0
+    sub  x1, x1, 0
+    mul  x1, 1
+    div  x1, x1, 1
+    shl  x1, 0
+    add  x2, x1, 0
+    mov  x0, x2
+    bl   putchar
+    mov  x3, 0
+loop:
+    cmp  x3, 3
+    beq  out
+    cmp  x3, 3
+    bgt  out
+    mov  x0, x3
+    add  x0, 48
+    bl   putchar
+    add  x3, 1
+    b    step
+step:
+    b    hop
+hop:
+    b    loop
+out:
+    b    done
+done:
+    mov  x0, 66
+    bl   putchar
+    mov  x0, 10
+    bl   putchar
+    mov  x0, 0
+    ret
@@ -0,0 +1,26 @@
+; ----------------------------------------------------
+                    .rodata
+; ----------------------------------------------------
+table:     .long   10, 20, 30
+message:   .asciz  "rodata"
+; ----------------------------------------------------
+                    .data
+; ----------------------------------------------------
+counter:   .quad   1
+; ----------------------------------------------------
+                    .text
+; ----------------------------------------------------
+main:
+    adrp    x8, table
+    mov     x5, 2
+    ldrs    l0, [x8, x5]
+    prg     x0
+    adrp    x8, message
+    mov     x5, 0
+    ldrs    x0, [x8, x5]
+    prg     x0
+    adrp    x9, counter
+    add     x0, x9, counter
+    prg     x0
+    mov     w0, 0
+    ret
@@ -0,0 +1,38 @@
+; Both calls are in the tail position, so neither one
+; grows the call stack or the value stack. Without the
+; rewrite they would exceed the 256 branch limit.
+count:
+    cmp  x0, 0
+    beq  count_done
+    dec  x0
+    inc  x1
+    bl   count
+    ret
+count_done:
+    ret
+
+sum:
+    stp  sp, 8
+    str  x0, [sp, 0]
+    cmp  x0, 0
+    beq  sum_done
+    add  x1, x1, x0
+    dec  x0
+    bl   sum
+    ldp  sp, 8
+    ret
+sum_done:
+    ldp  sp, 8
+    ret
+
+main:
+    mov  x0, 1000
+    mov  x1, 0
+    bl   count
+    prg  x1
+    mov  x0, 1000
+    mov  x1, 0
+    bl   sum
+    prg  x1
+    mov  x0, 0
+    ret
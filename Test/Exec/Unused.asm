@@ -0,0 +1,26 @@
+; Neither unused nor unused2 can be reached from main,
+; so they are left out of the image. alias1 has no
+; instructions of its own and starts where alias2 does.
+unused:
+    mov  x0, 65
+    bl   putchar
+    bl   unused2
+    ret
+unused2:
+    ret
+helper:
+    mov  x0, 66
+    bl   putchar
+    ret
+alias1:
+alias2:
+    mov  x0, 67
+    bl   putchar
+    ret
+main:
+    bl   helper
+    bl   alias1
+    mov  x0, 10
+    bl   putchar
+    mov  x0, 0
+    ret
@@ -0,0 +1,95 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "ImageCache.h"
+#include "BlockReader.h"
+#include "Catch2.h"
+
+const std::string HashFile = std::string(TestDirectory) + "/Basic/Keywords.asm";
+
+TEST_CASE("ImageCache1")
+{
+    BlockReader r;
+    r.open(HashFile.c_str());
+    EXPECT_FALSE(r.eof());
+
+    uint64_t a = ImageCache::hash(r.ptr(), r.size());
+    uint64_t b = ImageCache::hash(r.ptr(), r.size());
+    EXPECT_EQ(a, b);
+
+    // every length, including the partial word at the end
+    // has to contribute to the result
+    EXPECT_NE(a, ImageCache::hash(r.ptr(), r.size() - 1));
+    EXPECT_NE(a, ImageCache::hash(r.ptr(), r.size(), 1));
+    EXPECT_NE(ImageCache::hash("", 0), ImageCache::hash("\0", 1));
+}
+
+TEST_CASE("ImageCache2")
+{
+    ImageCache cache;
+    EXPECT_FALSE(cache.enabled());
+
+    ImageCacheKey key = {};
+    Sha256::digest("ImageCache2", 11, key.digest);
+    key.size    = 11;
+    key.modules = 3;
+
+    ImageCacheSlots slots, found;
+
+    EXPECT_NE(cache.store(key, slots), PS_OK);
+
+    cache.setDirectory(".");
+    EXPECT_TRUE(cache.enabled());
+
+    slots.push_back({0, 0, 4});
+    slots.push_back({IC_UNUSED, 0, 0});
+    slots.push_back({1, 0, 2});
+    EXPECT_EQ(cache.store(key, slots), PS_OK);
+    EXPECT_EQ(cache.find(key, found), PS_OK);
+
+    EXPECT_EQ(found.size(), slots.size());
+    EXPECT_EQ(memcmp(found.data(), slots.data(), slots.size() * sizeof(ImageCacheSlot)), 0);
+
+    // a changed module invalidates the record
+    key.modules = 4;
+    EXPECT_NE(cache.find(key, found), PS_OK);
+    EXPECT_TRUE(found.empty());
+
+    // so does a change in size
+    key.modules = 3;
+    key.size    = 12;
+    EXPECT_NE(cache.find(key, found), PS_OK);
+    key.size = 11;
+    EXPECT_EQ(cache.find(key, found), PS_OK);
+
+    // and any bit of the digest, even though it only
+    // names the record by the whole digest
+    key.digest[SHA256_SIZE - 1] ^= 1;
+    EXPECT_NE(cache.find(key, found), PS_OK);
+    key.digest[SHA256_SIZE - 1] ^= 1;
+
+    char name[SHA256_SIZE * 2 + 8] = "./";
+    int  i;
+    for (i = 0; i < SHA256_SIZE; ++i)
+        snprintf(name + 2 + i * 2, 3, "%02x", key.digest[i]);
+    strcat(name, ".tvc");
+    EXPECT_EQ(remove(name), 0);
+}
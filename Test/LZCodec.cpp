@@ -0,0 +1,97 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "LZCodec.h"
+#include "Catch2.h"
+
+static bool roundTrip(const std::vector<uint8_t>& src)
+{
+    LZBuffer packed;
+    LZCodec::compress(src.data(), src.size(), packed);
+
+    std::vector<uint8_t> dest(src.size() + 1, 0xCC);
+    if (LZCodec::decompress(packed.data(), packed.size(), dest.data(), src.size()) != PS_OK)
+        return false;
+    return memcmp(dest.data(), src.data(), src.size()) == 0 && dest[src.size()] == 0xCC;
+}
+
+TEST_CASE("LZCodec1")
+{
+    std::vector<uint8_t> src;
+    EXPECT_TRUE(roundTrip(src));
+
+    size_t i;
+    for (i = 0; i < 40; ++i)
+    {
+        src.push_back((uint8_t)i);
+        EXPECT_TRUE(roundTrip(src));
+    }
+
+    // runs with short offsets overlap the bytes they copy
+    src.assign(100000, 'a');
+    EXPECT_TRUE(roundTrip(src));
+
+    src.clear();
+    for (i = 0; i < 100000; ++i)
+        src.push_back((uint8_t)(i % 3));
+    EXPECT_TRUE(roundTrip(src));
+
+    // offsets longer than the window are not matched
+    uint32_t seed = 7;
+    std::vector<uint8_t> noise(70000);
+    for (i = 0; i < noise.size(); ++i)
+    {
+        seed     = seed * 1103515245 + 12345;
+        noise[i] = (uint8_t)(seed >> 16);
+    }
+    src = noise;
+    src.insert(src.end(), noise.begin(), noise.end());
+    EXPECT_TRUE(roundTrip(src));
+}
+
+TEST_CASE("LZCodec2")
+{
+    std::vector<uint8_t> src;
+    size_t               i;
+    for (i = 0; i < 4096; ++i)
+        src.push_back((uint8_t)(i % 251 < 100 ? 'x' : i));
+
+    LZBuffer packed;
+    LZCodec::compress(src.data(), src.size(), packed);
+    EXPECT_LT(packed.size(), src.size());
+
+    std::vector<uint8_t> dest(src.size());
+
+    // the expanded size has to match exactly
+    EXPECT_EQ(LZCodec::decompress(packed.data(), packed.size(), dest.data(), dest.size() - 1), PS_ERROR);
+    EXPECT_EQ(LZCodec::decompress(packed.data(), packed.size() - 1, dest.data(), dest.size()), PS_ERROR);
+
+    // damaged input is rejected without writing out of bounds
+    for (i = 0; i < packed.size(); ++i)
+    {
+        LZBuffer bad = packed;
+        bad[i] ^= 0xA5;
+        LZCodec::decompress(bad.data(), bad.size(), dest.data(), dest.size());
+    }
+
+    EXPECT_EQ(LZCodec::decompress(packed.data(), packed.size(), dest.data(), dest.size()), PS_OK);
+    EXPECT_EQ(memcmp(dest.data(), src.data(), src.size()), 0);
+}
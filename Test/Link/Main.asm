@@ -0,0 +1,15 @@
+; ----------------------------------------------------
+                    .data
+; ----------------------------------------------------
+greeting: .asciz "Hello from Main"
+; ----------------------------------------------------
+                    .text
+; ----------------------------------------------------
+main:
+    adrp  x0, greeting
+    bl    puts
+    bl    print_alphabet
+    adrp  x0, farewell
+    bl    puts
+    mov   x0, 0
+    ret
@@ -0,0 +1,20 @@
+; ----------------------------------------------------
+                    .data
+; ----------------------------------------------------
+farewell: .asciz "Goodbye from Print"
+; ----------------------------------------------------
+                    .text
+; ----------------------------------------------------
+print_alphabet:
+    mov  x1, 97
+loop:
+    cmp  x1, 123
+    beq  done
+    mov  x0, x1
+    bl   putchar
+    add  x1, x1, 1
+    b    loop
+done:
+    mov  x0, 10
+    bl   putchar
+    ret
@@ -0,0 +1,78 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "LoadProfile.h"
+#include <thread>
+#include "Catch2.h"
+
+TEST_CASE("LoadProfile1")
+{
+    LoadProfile prof;
+    {
+        // nothing is recorded until it is enabled
+        LoadTimer timer(prof, LP_CODE);
+        LoadProfile::countAllocation(64);
+    }
+    EXPECT_EQ(prof.getPhase(LP_CODE).seconds, 0);
+    EXPECT_EQ(prof.getPhase(LP_CODE).allocations, 0);
+
+    prof.setEnabled(true);
+    {
+        LoadTimer outer(prof, LP_SYMBOL);
+        LoadProfile::countAllocation(16);
+        {
+            LoadTimer inner(prof, LP_LIBRARY, "std");
+            LoadProfile::countAllocation(100);
+            LoadProfile::countAllocation(28);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    // the nested phase is not counted in the outer one
+    const LoadPhaseTime& sym = prof.getPhase(LP_SYMBOL);
+    const LoadPhaseTime& lib = prof.getPhase(LP_LIBRARY);
+    EXPECT_EQ(sym.allocations, 1);
+    EXPECT_EQ(sym.bytes, 16);
+    EXPECT_EQ(lib.allocations, 2);
+    EXPECT_EQ(lib.bytes, 128);
+    EXPECT_GE(lib.seconds, 0.002);
+    EXPECT_LT(sym.seconds, lib.seconds);
+
+    EXPECT_EQ(prof.getDetails().size(), 1);
+    EXPECT_TRUE(prof.getDetails()[0].name == "std");
+    EXPECT_EQ(prof.getDetails()[0].phase, LP_LIBRARY);
+
+    LoadPhaseTime sum = prof.total();
+    EXPECT_EQ(sum.allocations, 3);
+    EXPECT_EQ(sum.bytes, 144);
+    EXPECT_TRUE(strcmp(LoadProfile::getPhaseName(LP_VERIFY), "verify") == 0);
+
+    // another profile turning off does not stop the counting
+    {
+        LoadProfile other;
+        other.setEnabled(true);
+        other.setEnabled(false);
+
+        LoadTimer timer(prof, LP_DATA);
+        LoadProfile::countAllocation(8);
+    }
+    EXPECT_EQ(prof.getPhase(LP_DATA).allocations, 1);
+}
@@ -140,3 +140,36 @@ TEST_CASE("Memory3")
         ptr += 8;
     }
 }
+
+TEST_CASE("Memory4")
+{
+    // huge page blocks start on a huge page boundary, and
+    // still work when the system does not provide them
+    MemoryStream ms;
+    ms.map(HUGE_PAGE_SIZE + 100, PM_HUGE);
+    EXPECT_EQ((size_t)ms.ptr() % HUGE_PAGE_SIZE, 0);
+    EXPECT_EQ(ms.capacity(), HUGE_PAGE_SIZE + 100);
+    EXPECT_EQ(ms.ptr()[HUGE_PAGE_SIZE + 99], 0);
+
+    ms.ptr()[HUGE_PAGE_SIZE + 99] = 0xFF;
+    ms.clear();
+    EXPECT_TRUE(ms.ptr() == nullptr);
+
+    PageAllocator<ExecInstruction> huge(PM_HUGE);
+    ExecInstructions               ins(huge);
+    ins.resize(HUGE_PAGE_SIZE / sizeof(ExecInstruction));
+    EXPECT_EQ((size_t)ins.data() % HUGE_PAGE_SIZE, 0);
+    ins.back().op = OP_RET;
+    ins.push_back(ins.back());
+    EXPECT_EQ((size_t)ins.data() % HUGE_PAGE_SIZE, 0);
+    EXPECT_EQ(ins.back().op, OP_RET);
+
+    // the stack keeps its values when it grows
+    ArrayStack stk;
+    stk.setMode(PM_HUGE);
+    uint32_t i;
+    for (i = 0; i < 1000; ++i)
+        stk.push(i);
+    for (i = 0; i < 1000; ++i)
+        EXPECT_EQ(stk.peek(i), 999 - i);
+}
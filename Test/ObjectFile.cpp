@@ -0,0 +1,105 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "ObjectFile.h"
+#include <stdio.h>
+#include "Catch2.h"
+#include "Parser.h"
+
+const std::string ObjectSource = std::string(TestDirectory) + "/Link/Print.asm";
+
+TEST_CASE("ObjectFile1")
+{
+    EXPECT_TRUE(ObjectFile::isObject("Print.tvo"));
+    EXPECT_FALSE(ObjectFile::isObject("Print.asm"));
+    EXPECT_FALSE(ObjectFile::isObject(".tvo"));
+    EXPECT_FALSE(ObjectFile::isObject(nullptr));
+
+    Parser p;
+    EXPECT_EQ(p.parse(ObjectSource.c_str()), PS_OK);
+
+    const CompileUnit& src = p.getUnit();
+    EXPECT_EQ(ObjectFile::save(src, "ObjectFile1.tvo"), PS_OK);
+
+    CompileUnit obj;
+    EXPECT_EQ(ObjectFile::load(obj, "ObjectFile1.tvo"), PS_OK);
+    EXPECT_EQ(obj.labels, src.labels);
+    EXPECT_EQ(obj.names.size(), src.names.size());
+    EXPECT_EQ(obj.info.size(), src.info.size());
+    EXPECT_EQ(obj.ins.size(), src.ins.size());
+    EXPECT_EQ(obj.data.size(), 1);
+
+    size_t i;
+    for (i = 0; i < obj.names.size(); ++i)
+    {
+        EXPECT_EQ(obj.names.get(i), src.names.get(i));
+        EXPECT_EQ(obj.info[i].label, src.info[i].label);
+        EXPECT_EQ(obj.info[i].data, src.info[i].data);
+    }
+
+    for (i = 0; i < obj.ins.size(); ++i)
+    {
+        const Instruction& a = obj.ins[i];
+        const Instruction& b = src.ins[i];
+        EXPECT_EQ(a.op, b.op);
+        EXPECT_EQ(a.argc, b.argc);
+        EXPECT_EQ(a.flags, b.flags);
+        EXPECT_EQ(a.name, b.name);
+        EXPECT_EQ(a.label, b.label);
+        EXPECT_EQ(a.argv[0], b.argv[0]);
+        EXPECT_EQ(a.argv[1], b.argv[1]);
+    }
+
+    const DataDeclaration& dt = obj.data[0];
+    EXPECT_EQ(obj.names.get(dt.name), "farewell");
+    EXPECT_EQ(dt.type, SEC_ASCII);
+    EXPECT_EQ(dt.sval, "Goodbye from Print");
+    remove("ObjectFile1.tvo");
+}
+
+TEST_CASE("ObjectFile2")
+{
+    Parser p;
+    EXPECT_EQ(p.parse(ObjectSource.c_str()), PS_OK);
+    EXPECT_EQ(ObjectFile::save(p.getUnit(), "ObjectFile2.tvo"), PS_OK);
+
+    // a truncated object is rejected as a whole
+    FILE* fp = fopen("ObjectFile2.tvo", "rb");
+    EXPECT_NE(fp, nullptr);
+
+    char   buf[1024];
+    size_t len = fread(buf, 1, sizeof buf, fp);
+    fclose(fp);
+    EXPECT_GT(len, 64);
+
+    fp = fopen("ObjectFile2.tvo", "wb");
+    fwrite(buf, 1, len - 8, fp);
+    fclose(fp);
+
+    CompileUnit obj;
+    EXPECT_EQ(ObjectFile::load(obj, "ObjectFile2.tvo"), PS_ERROR);
+    EXPECT_TRUE(obj.ins.empty());
+    EXPECT_TRUE(obj.names.empty());
+
+    // as is anything that is not an object
+    EXPECT_EQ(ObjectFile::load(obj, ObjectSource.c_str()), PS_ERROR);
+    remove("ObjectFile2.tvo");
+}
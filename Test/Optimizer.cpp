@@ -0,0 +1,125 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Optimizer.h"
+#include "Catch2.h"
+#include "Parser.h"
+
+TEST_CASE("Optimizer1")
+{
+    const std::string TestFile = std::string(TestDirectory) + "/Exec/Unused.asm";
+
+    Parser p;
+    EXPECT_EQ(p.parse(TestFile.c_str()), PS_OK);
+
+    CompileUnit& unit = p.getUnit();
+    EXPECT_EQ(unit.ins.size(), 17);
+
+    Optimizer opt(unit.ins, unit.info);
+    EXPECT_EQ(opt.unreferencedFunctions(0), 0);
+
+    int64_t main = unit.names.find("main");
+    EXPECT_GT(main, 0);
+
+    // unused and unused2 are dropped, and the rest is kept in order
+    EXPECT_EQ(opt.unreferencedFunctions((uint32_t)main), 5);
+    EXPECT_EQ(unit.ins.size(), 12);
+    EXPECT_EQ(unit.ins[0].label, unit.info[unit.names.find("helper")].label);
+    EXPECT_EQ(unit.ins[3].label, unit.info[unit.names.find("alias2")].label);
+    EXPECT_EQ(unit.ins[11].op, OP_RET);
+
+    EXPECT_EQ(opt.unreferencedFunctions((uint32_t)main), 0);
+}
+
+TEST_CASE("Optimizer2")
+{
+    const std::string TestFile = std::string(TestDirectory) + "/Exec/Peephole.asm";
+
+    Parser p;
+    EXPECT_EQ(p.parse(TestFile.c_str()), PS_OK);
+
+    CompileUnit& unit = p.getUnit();
+    EXPECT_EQ(unit.ins.size(), 29);
+
+    Optimizer      opt(unit.ins, unit.info);
+    PeepholeCounts counts = {};
+
+    // nothing is selected
+    EXPECT_EQ(opt.peephole(0, counts), 0);
+    EXPECT_EQ(unit.ins.size(), 29);
+
+    EXPECT_EQ(opt.peephole(PR_BIT(PR_MOVE), counts), 1);
+    EXPECT_EQ(unit.ins.size(), 28);
+    EXPECT_EQ(counts.rule[PR_MOVE], 1);
+    EXPECT_EQ(counts.rule[PR_IDENTITY], 0);
+
+    EXPECT_EQ(opt.peephole(PR_ALL, counts), 12);
+    EXPECT_EQ(unit.ins.size(), 19);
+    EXPECT_EQ(counts.rule[PR_MOVE], 1);
+    EXPECT_EQ(counts.rule[PR_IDENTITY], 6);
+    EXPECT_EQ(counts.rule[PR_NEXT], 3);
+    EXPECT_EQ(counts.rule[PR_CHAIN], 2);
+    EXPECT_EQ(counts.rule[PR_COMPARE], 1);
+
+    // add x2, x1, 0 is now a move
+    EXPECT_EQ(unit.ins[1].op, OP_MOV);
+    EXPECT_EQ(unit.ins[1].argc, 2);
+    EXPECT_EQ(unit.ins[1].argv[0], 2);
+    EXPECT_EQ(unit.ins[1].argv[1], 1);
+
+    // both branches out of the loop skip over out
+    uint32_t done = (uint32_t)unit.names.find("done");
+    EXPECT_EQ(unit.ins[6].op, OP_JEQ);
+    EXPECT_EQ(unit.ins[6].name, done);
+    EXPECT_EQ(unit.ins[7].op, OP_JGT);
+    EXPECT_EQ(unit.ins[7].name, done);
+
+    EXPECT_EQ(opt.peephole(PR_ALL, counts), 0);
+
+    EXPECT_EQ(Optimizer::findRule("chain"), PR_CHAIN);
+    EXPECT_EQ(Optimizer::findRule("none"), -1);
+    EXPECT_TRUE(strcmp(Optimizer::getRuleName(PR_COMPARE), "compare") == 0);
+}
+
+TEST_CASE("Optimizer3")
+{
+    const std::string TestFile = std::string(TestDirectory) + "/Exec/Chain.asm";
+
+    Parser p;
+    EXPECT_EQ(p.parse(TestFile.c_str()), PS_OK);
+
+    CompileUnit&   unit = p.getUnit();
+    Optimizer      opt(unit.ins, unit.info);
+    PeepholeCounts counts = {};
+
+    // every b in front of hop19 goes straight to hop20,
+    // and the loop is left alone
+    EXPECT_EQ(opt.peephole(PR_BIT(PR_CHAIN), counts), 19);
+
+    uint32_t end = (uint32_t)unit.names.find("hop20");
+    EXPECT_EQ(unit.ins[4].op, OP_JMP);
+    EXPECT_EQ(unit.ins[4].name, end);
+    EXPECT_EQ(unit.ins[5].name, end);
+
+    uint32_t spin2 = (uint32_t)unit.names.find("spin2");
+    EXPECT_EQ(unit.ins[26].name, spin2);
+    EXPECT_EQ(opt.peephole(PR_BIT(PR_CHAIN), counts), 0);
+}
@@ -211,3 +211,111 @@ TEST_CASE("Scan6")
     int    sr = p.parse(TestFile.c_str());
     EXPECT_EQ(sr, PS_OK);
 }
+
+TEST_CASE("Scan7")
+{
+    const std::string TestFile = std::string(TestDirectory) + "/Scan/Scan7.asm";
+
+    Parser p;
+    int    sr = p.parse(TestFile.c_str());
+    EXPECT_EQ(sr, PS_OK);
+
+    const DataDeclarations& decl = p.getDataDeclarations();
+    EXPECT_EQ(decl.size(), 3);
+
+    const DataDeclaration& bytes = *p.findDataDeclaration("bytes");
+    EXPECT_EQ(bytes.type, SEC_BYTE);
+    EXPECT_EQ(bytes.values.size(), 3);
+    EXPECT_EQ(bytes.values[2], 3);
+
+    const DataDeclaration& words = *p.findDataDeclaration("words");
+    EXPECT_EQ(words.type, SEC_WORD);
+    EXPECT_EQ(words.values.size(), 2);
+    EXPECT_EQ(words.values[1], 0x20);
+
+    const DataDeclaration& quad = *p.findDataDeclaration("quad");
+    EXPECT_EQ(quad.type, SEC_QUAD);
+    EXPECT_EQ(quad.values.size(), 1);
+    EXPECT_EQ(quad.ival, 7);
+}
+
+TEST_CASE("Scan8")
+{
+    const std::string TestFile = std::string(TestDirectory) + "/Scan/Scan8.asm";
+
+    Parser p;
+    int    sr = p.parse(TestFile.c_str());
+    EXPECT_EQ(sr, PS_OK);
+
+    const DataDeclarations& decl = p.getDataDeclarations();
+    EXPECT_EQ(decl.size(), 3);
+    EXPECT_TRUE(p.findDataDeclaration("table")->readonly);
+    EXPECT_FALSE(p.findDataDeclaration("counter")->readonly);
+    EXPECT_TRUE(p.findDataDeclaration("message")->readonly);
+}
+
+TEST_CASE("Scan9")
+{
+    const std::string TestFile = std::string(TestDirectory) + "/Scan/Scan9.asm";
+
+    Parser p;
+    int    sr = p.open(TestFile.c_str());
+    EXPECT_EQ(sr, PS_OK);
+
+    Token tok;
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_OPCODE);
+    EXPECT_EQ(tok.op, OP_ADRP);
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_REGISTER);
+    EXPECT_EQ(tok.reg, 9);
+    EXPECT_EQ(tok.regtype, IF_BTEW);
+
+    // only the exact register spellings are registers
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_IDENTIFIER);
+    EXPECT_EQ(tok.value, "space");
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_OPCODE);
+    EXPECT_EQ(tok.op, OP_PRI);
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_OPCODE);
+    EXPECT_EQ(tok.op, OP_STRS);
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_REGISTER);
+    EXPECT_EQ(tok.reg, 3);
+    EXPECT_EQ(tok.regtype, IF_BTEB);
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_REGISTER);
+    EXPECT_EQ(tok.regtype, IF_STKP);
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_OPCODE);
+    EXPECT_EQ(tok.op, OP_GTO);
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_IDENTIFIER);
+    EXPECT_EQ(tok.value, "pcount");
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_IDENTIFIER);
+    EXPECT_EQ(tok.value, "x1abc");
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_LABEL);
+    EXPECT_EQ(tok.value, "msg");
+
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_SECTION);
+    EXPECT_EQ(tok.value, "asciz");
+
+    // escape sequences are replaced in a copy of the string
+    p.scan(tok);
+    EXPECT_EQ(tok.type, TOK_ASCII);
+    EXPECT_EQ(tok.value, "ab\t\"c");
+}
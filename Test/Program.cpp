@@ -0,0 +1,100 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Program.h"
+#include "Catch2.h"
+
+// Gives the test access to the native call path
+// without loading a module.
+class CallProgram : public Program
+{
+public:
+    CallProgram() :
+        Program("")
+    {
+    }
+
+    void bind(const SymbolTable& sym)
+    {
+        m_calls.assign(1, &sym);
+        m_memo.assign(1, {});
+    }
+
+    void call(void)
+    {
+        invoke(0);
+    }
+
+    Register& reg(int i)
+    {
+        return m_regi[i];
+    }
+};
+
+int addCalls = 0;
+
+void addSymbol(tvmregister_t regi)
+{
+    // only the registers that are passed are set
+    ++addCalls;
+    uint64_t sum = prog_get_register64(regi, 0) + prog_get_register64(regi, 1);
+    prog_set_register64(regi, 0, sum + prog_get_register64(regi, 2));
+}
+
+TEST_CASE("Program1")
+{
+    SymbolTable sym = {"add", addSymbol, SA_PURE | SA_NMEM | SA_RMSK | SA_WMSK, SYM_REG(0) | SYM_REG(1), SYM_REG(0)};
+
+    CallProgram prog;
+    prog.bind(sym);
+
+    addCalls      = 0;
+    prog.reg(0).x = 2;
+    prog.reg(1).x = 3;
+    prog.reg(2).x = 100;
+    prog.call();
+    EXPECT_EQ(prog.reg(0).x, 5);
+    EXPECT_EQ(addCalls, 1);
+
+    // the same inputs reuse the last result
+    prog.reg(0).x = 2;
+    prog.reg(2).x = 200;
+    prog.call();
+    EXPECT_EQ(prog.reg(0).x, 5);
+    EXPECT_EQ(addCalls, 1);
+
+    // a different input calls it again
+    prog.reg(0).x = 2;
+    prog.reg(1).x = 4;
+    prog.call();
+    EXPECT_EQ(prog.reg(0).x, 6);
+    EXPECT_EQ(addCalls, 2);
+
+    // without SA_PURE every call is made
+    sym.attributes &= ~SA_PURE;
+    prog.bind(sym);
+    prog.reg(0).x = 2;
+    prog.call();
+    prog.reg(0).x = 2;
+    prog.call();
+    EXPECT_EQ(prog.reg(0).x, 6);
+    EXPECT_EQ(addCalls, 4);
+}
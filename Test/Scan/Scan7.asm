@@ -0,0 +1,7 @@
+            .data
+bytes:      .byte   1, 2, 3
+words:      .word   0x10, 0x20
+quad:       .quad   7
+            .text
+main:
+    ret
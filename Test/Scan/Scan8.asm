@@ -0,0 +1,9 @@
+            .rodata
+table:      .long   1, 2
+            .data
+counter:    .quad   0
+            .rodata
+message:    .asciz  "const"
+            .text
+main:
+    ret
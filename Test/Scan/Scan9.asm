@@ -0,0 +1,6 @@
+adrp w9, space
+prgi
+strs b3, sp
+bl pcount
+x1abc
+msg: .asciz "ab\t\"c"
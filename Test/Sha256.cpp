@@ -0,0 +1,69 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "Sha256.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "Catch2.h"
+
+static std::string toHex(const uint8_t digest[SHA256_SIZE])
+{
+    char buf[SHA256_SIZE * 2 + 1];
+    int  i;
+    for (i = 0; i < SHA256_SIZE; ++i)
+        snprintf(buf + i * 2, 3, "%02x", digest[i]);
+    return buf;
+}
+
+TEST_CASE("Sha256_1")
+{
+    uint8_t digest[SHA256_SIZE];
+
+    Sha256::digest("", 0, digest);
+    EXPECT_EQ(toHex(digest), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    Sha256::digest("abc", 3, digest);
+    EXPECT_EQ(toHex(digest), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    // two blocks, where the length no longer fits in the first
+    const char* two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    Sha256::digest(two, strlen(two), digest);
+    EXPECT_EQ(toHex(digest), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST_CASE("Sha256_2")
+{
+    // a million a's, fed in pieces that do not line up with a block
+    std::string block(1000, 'a');
+
+    Sha256 sha;
+    size_t i;
+    for (i = 0; i < 1000; ++i)
+    {
+        sha.update(block.data(), 7);
+        sha.update(block.data(), 993);
+    }
+
+    uint8_t digest[SHA256_SIZE];
+    sha.finish(digest);
+    EXPECT_EQ(toHex(digest), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
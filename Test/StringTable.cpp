@@ -0,0 +1,112 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "StringTable.h"
+#include <utility>
+#include "Catch2.h"
+
+TEST_CASE("StringTable1")
+{
+    StringTable tab;
+    EXPECT_TRUE(tab.empty());
+    EXPECT_EQ(tab.find("puts"), -1);
+
+    EXPECT_EQ(tab.intern("puts"), 0);
+    EXPECT_EQ(tab.intern("putchar"), 1);
+    EXPECT_EQ(tab.intern("puts"), 0);
+    EXPECT_EQ(tab.size(), 2);
+
+    EXPECT_EQ(tab.find("putchar"), 1);
+    EXPECT_EQ(tab.find("put"), -1);
+    EXPECT_TRUE(tab.get(0) == "puts");
+    EXPECT_EQ(strcmp(tab.c_str(1), "putchar"), 0);
+    EXPECT_TRUE(tab.get(2).empty());
+
+    // force it to grow past the initial capacity
+    int i;
+    for (i = 0; i < 1000; ++i)
+        EXPECT_EQ(tab.intern("s" + std::to_string(i)), (uint32_t)i + 2);
+    for (i = 0; i < 1000; ++i)
+        EXPECT_EQ(tab.find("s" + std::to_string(i)), i + 2);
+    EXPECT_EQ(tab.size(), 1002);
+}
+
+TEST_CASE("StringTable2")
+{
+    StringTable src;
+    src.intern("printf");
+    src.intern("exit");
+    src.intern("main");
+
+    // lay it out the same way that BinaryWriter does
+    std::vector<char> block(src.byteSize());
+    uint32_t          count = (uint32_t)src.size();
+
+    memcpy(block.data(), &count, sizeof(uint32_t));
+    memcpy(block.data() + 4, src.offsets(), count * sizeof(uint32_t));
+    memcpy(block.data() + 4 + count * 4, src.data(), src.dataSize());
+
+    StringTable dst;
+    EXPECT_EQ(dst.load(block.data(), block.size()), PS_OK);
+    EXPECT_EQ(dst.size(), 3);
+    EXPECT_TRUE(dst.get(0) == "printf");
+    EXPECT_TRUE(dst.get(2) == "main");
+    EXPECT_EQ(dst.find("exit"), 1);
+
+    // the loaded table references the block
+    EXPECT_EQ(dst.data(), block.data() + 16);
+
+    // adding to it copies the block first
+    EXPECT_EQ(dst.intern("abort"), 3);
+    EXPECT_EQ(dst.intern("exit"), 1);
+    EXPECT_NE(dst.data(), block.data() + 16);
+    EXPECT_TRUE(dst.get(0) == "printf");
+
+    // an unterminated string
+    block.back() = 'x';
+    EXPECT_EQ(dst.load(block.data(), block.size()), PS_ERROR);
+
+    // too many offsets
+    count = 100;
+    memcpy(block.data(), &count, sizeof(uint32_t));
+    EXPECT_EQ(dst.load(block.data(), block.size()), PS_ERROR);
+}
+
+TEST_CASE("StringTable3")
+{
+    StringTable src;
+    EXPECT_EQ(src.intern(""), 0);
+    EXPECT_EQ(src.intern("main"), 1);
+    const char* data = src.data();
+
+    // moving keeps the strings where they are
+    StringTable dst(std::move(src));
+    EXPECT_TRUE(src.empty());
+    EXPECT_EQ(dst.size(), 2);
+    EXPECT_EQ(dst.data(), data);
+    EXPECT_TRUE(dst.get(1) == "main");
+    EXPECT_EQ(dst.find("main"), 1);
+    EXPECT_EQ(dst.intern("exit"), 2);
+
+    src = std::move(dst);
+    EXPECT_TRUE(dst.empty());
+    EXPECT_EQ(src.find("exit"), 2);
+}
@@ -0,0 +1,151 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "TextScan.h"
+#include <string.h>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Catch2.h"
+
+TEST_CASE("TextScan1")
+{
+    const char* src = "  \t mov_x1, 10 ; a comment\r\n\r\n\n\rnext";
+    const uint8_t* p = (const uint8_t*)src;
+
+    int mode;
+    for (mode = TSM_SCALAR; mode <= TSM_AVX2; ++mode)
+    {
+        SetTextScanMode(mode);
+
+        EXPECT_EQ(SkipWhiteSpace(p, strlen(src)), 4);
+        EXPECT_EQ(SkipIdentifier(p + 4, strlen(src) - 4), 6);
+        EXPECT_EQ(FindLineEnd(p, strlen(src)), 26);
+        EXPECT_EQ(FindLineEnd(p, 10), 10);
+
+        int32_t lines = 0;
+        EXPECT_EQ(SkipNewLines(p + 26, strlen(src) - 26, lines), 6);
+        EXPECT_EQ(lines, 4);
+
+        // a CR at the end of the input ends a line
+        lines = 0;
+        EXPECT_EQ(SkipNewLines(p + 26, 1, lines), 1);
+        EXPECT_EQ(lines, 1);
+    }
+}
+
+TEST_CASE("TextScan2")
+{
+    // every mode has to agree with the scalar one,
+    // including across the 16 and 32 byte blocks
+    const char       chars[] = "  \t\t\r\n\n\raZ_09;.,#\0\x80";
+    std::mt19937     rng(1234);
+    std::vector<int> modes;
+
+    int mode;
+    for (mode = TSM_SCALAR; mode <= TSM_AVX2; ++mode)
+    {
+        SetTextScanMode(mode);
+        if (GetTextScanMode() == mode)
+            modes.push_back(mode);
+    }
+
+    int i, j;
+    for (i = 0; i < 2000; ++i)
+    {
+        // runs of one class of characters, so that
+        // matches cross the block boundaries
+        std::vector<uint8_t> buf;
+        while (buf.size() < 100)
+        {
+            int span[4][2] = {{0, 4}, {4, 8}, {8, 13}, {0, 20}};
+            int from       = rng() % 4;
+            int run        = 1 + rng() % 40;
+            for (j = 0; j < run; ++j)
+                buf.push_back((uint8_t)chars[span[from][0] + rng() % (span[from][1] - span[from][0])]);
+        }
+        buf.resize(rng() % 100);
+
+        size_t start = buf.empty() ? 0 : rng() % buf.size();
+        size_t len   = buf.size() - start;
+
+        SetTextScanMode(TSM_SCALAR);
+        int32_t lines = 0;
+        size_t  ws    = SkipWhiteSpace(buf.data() + start, len);
+        size_t  id    = SkipIdentifier(buf.data() + start, len);
+        size_t  eol   = FindLineEnd(buf.data() + start, len);
+        size_t  nl    = SkipNewLines(buf.data() + start, len, lines);
+
+        std::vector<int>::iterator it = modes.begin();
+        for (; it != modes.end(); ++it)
+        {
+            SetTextScanMode(*it);
+
+            int32_t count = 0;
+            EXPECT_EQ(SkipWhiteSpace(buf.data() + start, len), ws);
+            EXPECT_EQ(SkipIdentifier(buf.data() + start, len), id);
+            EXPECT_EQ(FindLineEnd(buf.data() + start, len), eol);
+            EXPECT_EQ(SkipNewLines(buf.data() + start, len, count), nl);
+            EXPECT_EQ(count, lines);
+        }
+    }
+    SetTextScanMode(TSM_AVX2);
+}
+
+TEST_CASE("TextScan3")
+{
+    // ScanInteger has to give the same result as strtoull
+    // on the same characters
+    const char*  tests[] = {
+        "0",
+        "10",
+        "-1",
+        "ff",
+        "0x1F",
+        "0x",
+        "0xg",
+        "0b101",
+        "1010b",
+        "12ab",
+        "18446744073709551615",
+        "18446744073709551616",
+        "-18446744073709551615",
+        "ffffffffffffffffff",
+        "",
+    };
+    const int bases[] = {2, 10, 16};
+
+    size_t i, b;
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i)
+    {
+        for (b = 0; b < 3; ++b)
+        {
+            const uint8_t* src = (const uint8_t*)tests[i];
+
+            uint64_t expect = std::strtoull(tests[i], nullptr, bases[b]);
+            EXPECT_EQ(ScanInteger(src, strlen(tests[i]), bases[b]), expect);
+        }
+    }
+
+    // it stops at len
+    EXPECT_EQ(ScanInteger((const uint8_t*)"1234", 2, 10), 12);
+    EXPECT_EQ(ScanInteger((const uint8_t*)"0x12", 2, 16), 0);
+}
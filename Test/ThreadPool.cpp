@@ -0,0 +1,97 @@
+/*
+-------------------------------------------------------------------------------
+    Copyright (c) 2020 Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "Catch2.h"
+
+TEST_CASE("ThreadPool1")
+{
+    ThreadPool one(1), four(4), cores;
+    EXPECT_EQ(one.size(), 1);
+    EXPECT_EQ(four.size(), 4);
+    EXPECT_GE(cores.size(), 1);
+
+    // every task runs exactly once
+    std::vector<int> ran(1000, 0);
+    four.run(ran.size(), [&ran](size_t i) { ran[i]++; });
+
+    size_t i;
+    for (i = 0; i < ran.size(); ++i)
+        EXPECT_EQ(ran[i], 1);
+
+    std::atomic<size_t> sum(0);
+    one.run(100, [&sum](size_t i) { sum += i; });
+    EXPECT_EQ(sum, 4950);
+
+    // fewer tasks than threads, and none at all
+    sum = 0;
+    four.run(2, [&sum](size_t i) { sum += i + 1; });
+    EXPECT_EQ(sum, 3);
+    four.run(0, [&sum](size_t) { sum = 0; });
+    EXPECT_EQ(sum, 3);
+}
+
+TEST_CASE("ThreadPool2")
+{
+    // the same threads run one job after another
+    ThreadPool pool(4);
+
+    std::atomic<size_t> sum(0);
+    int                 job;
+    for (job = 0; job < 200; ++job)
+        pool.run(64, [&sum](size_t i) { sum += i; });
+    EXPECT_EQ(sum, 200 * 2016);
+
+    pool.setThreads(2);
+    EXPECT_EQ(pool.size(), 2);
+
+    sum = 0;
+    pool.run(64, [&sum](size_t i) { sum += i; });
+    EXPECT_EQ(sum, 2016);
+
+    pool.setThreads(0);
+    EXPECT_GE(pool.size(), 1);
+}
+
+TEST_CASE("ThreadPool3")
+{
+    // new threads do not pick up the job that ran before
+    // them, so run still waits for every task to finish
+    ThreadPool pool(4);
+
+    std::atomic<size_t> done(0);
+    int                 job;
+    for (job = 0; job < 500; ++job)
+    {
+        done = 0;
+        pool.run(16, [&done](size_t) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            ++done;
+        });
+        EXPECT_EQ(done, 16);
+
+        pool.setThreads(4);
+    }
+}